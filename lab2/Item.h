@@ -4,9 +4,13 @@
   Description: template class Item and derived class Deleted_Item
 */
 
+#ifndef ITEM_H
+#define ITEM_H
+
 #include <iostream>
 #include <iomanip>
 #include <new>
+#include <utility>
 
 using namespace std;
 
@@ -22,6 +26,10 @@ public:
     explicit Item(const Key_Type& k, const Value_Type& v)
         : key(k) , value(v) {  }
 
+    //Constructor to create an item given a temporary key k and a value v
+    explicit Item(Key_Type&& k, const Value_Type& v)
+        : key(std::move(k)) , value(v) {  }
+
 
     //Return item's key
     const Key_Type& get_key() const
@@ -36,6 +44,11 @@ public:
         return value;
     }
 
+    const Value_Type& get_value() const
+    {
+        return value;
+    }
+
     //Modify the item's value to v
     void set_value(const Value_Type& v)
     {
@@ -70,23 +83,17 @@ class Deleted_Item: public Item<Key_Type,Value_Type>
 public:
 
     //Return pointer to the item used to mark deleted entries in the table
+    //Only one instance of the class is needed to mark deleted slots of the table
+    //The local static is created on the first call, also when several threads call at once
     static Deleted_Item *get_Item()
     {
-        if (!entry)
-        {
-            entry = new Deleted_Item();
-
-            //cout << "Dummy item created!!" << endl;
-        }
+        static Deleted_Item *entry = new Deleted_Item();
 
         return entry;
     }
 
 private:
 
-    //Only one instance of the class is needed to mark deleted slots of the table
-    static Deleted_Item *entry;
-
     //Default constructor
     //Private member function so that only member functions can create class instances
     Deleted_Item()
@@ -95,6 +102,4 @@ private:
 };
 
 
-//Initialize static data member (entry)
-template <typename Key_Type, typename Value_Type>
-Deleted_Item<Key_Type,Value_Type> *Deleted_Item<Key_Type,Value_Type>::entry = nullptr;
+#endif
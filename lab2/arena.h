@@ -0,0 +1,167 @@
+/*
+  Course: TND004, Lab 2
+  Description: class Arena, a bump allocator that releases all its memory at once,
+              and template class Pool, a pool of objects of the same type
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+using namespace std;
+
+
+//Class to represent an arena (region) of memory
+//Memory is taken from large blocks by moving a pointer forward
+//Single allocations are never freed: all blocks are released by the destructor
+class Arena
+{
+public:
+
+    //Constructor to create an empty arena
+    //block_size is the size in bytes of the blocks taken from the heap
+    explicit Arena(size_t block_size = 64 * 1024)
+        : next(nullptr), limit(nullptr), blockSize(block_size), total(0) {  }
+
+
+    //Destructor
+    ~Arena()
+    {
+        for (char* b : blocks)
+        {
+            delete[] b;
+        }
+    }
+
+
+    //Return a pointer to n bytes aligned to align (a power of two)
+    void* allocate(size_t n, size_t align = alignof(max_align_t))
+    {
+        uintptr_t p = ((uintptr_t) next + align - 1) & ~(uintptr_t) (align - 1);
+
+        if (!next || p + n > (uintptr_t) limit)
+        {
+            //allocations larger than a block get their own block
+            size_t size = (n + align > blockSize) ? n + align : blockSize;
+            char* block = new char[size];
+
+            blocks.push_back(block);
+            total += size;
+            limit = block + size;
+
+            p = ((uintptr_t) block + align - 1) & ~(uintptr_t) (align - 1);
+        }
+
+        next = (char*) (p + n);
+
+        return (void*) p;
+    }
+
+
+    //Return the number of blocks taken from the heap
+    size_t get_number_OF_blocks() const
+    {
+        return blocks.size();
+    }
+
+    //Return the number of bytes taken from the heap
+    size_t get_allocated_bytes() const
+    {
+        return total;
+    }
+
+private:
+
+    vector<char*> blocks;
+    char* next;   //first free byte of the current block
+    char* limit;  //end of the current block
+    size_t blockSize;
+    size_t total;
+
+    //Disable copy constructor!!
+    Arena(const Arena &) = delete;
+
+    //Disable assignment operator!!
+    const Arena& operator=(const Arena &) = delete;
+};
+
+
+//Template class to represent a pool of objects of type T
+//The objects are taken from an arena, and released objects are kept in a free list
+//so that the next object created reuses their memory
+//All memory is released at once by the destructor: the objects still in use are not destroyed
+template <typename T>
+class Pool
+{
+public:
+
+    //Constructor to create an empty pool
+    //block_size is the size in bytes of the blocks of the arena
+    explicit Pool(size_t block_size = 64 * 1024)
+        : arena(block_size), free_list(nullptr) {  }
+
+
+    //Create an object T(args...)
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        void* p;
+
+        if (free_list)
+        {
+            p = free_list;
+            free_list = free_list->next;
+        }
+        else
+        {
+            p = arena.allocate(SIZE, ALIGN);
+        }
+
+        return new (p) T(std::forward<Args>(args)...);
+    }
+
+
+    //Destroy object p, created by this pool
+    void destroy(T* p)
+    {
+        p->~T();
+
+        Free_Node* f = reinterpret_cast<Free_Node*>(p);
+        f->next = free_list;
+        free_list = f;
+    }
+
+
+    //Return the number of bytes taken from the heap
+    size_t get_allocated_bytes() const
+    {
+        return arena.get_allocated_bytes();
+    }
+
+private:
+
+    //A released object, linked in the free list
+    struct Free_Node
+    {
+        Free_Node* next;
+    };
+
+    static constexpr size_t SIZE = sizeof(T) > sizeof(Free_Node) ? sizeof(T) : sizeof(Free_Node);
+    static constexpr size_t ALIGN = alignof(T) > alignof(Free_Node) ? alignof(T) : alignof(Free_Node);
+
+    Arena arena;
+    Free_Node* free_list;
+
+    //Disable copy constructor!!
+    Pool(const Pool &) = delete;
+
+    //Disable assignment operator!!
+    const Pool& operator=(const Pool &) = delete;
+};
+
+#endif
@@ -0,0 +1,496 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class Async_HashTable represents a hash table that is
+              re-hashed in a background thread, so that no operation waits for a re-hash
+*/
+
+#ifndef ASYNC_HASH_TABLE_H
+#define ASYNC_HASH_TABLE_H
+
+#include "hashTable.h"
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <system_error>
+
+using namespace std;
+
+
+//Template class to represent a hash table whose re-hash does not stop the operations
+//When the load factor goes above maxLoadFactor, a background thread builds a larger table
+//from the current one. Meanwhile the current table is read only, and the insertions and
+//removals are recorded in a small delta table, which is searched before the current table
+//When the new table is ready, the next operation applies the delta to it and swaps the tables
+//The Items are not copied: the new table stores pointers to the Items of the current table
+//Only the background thread is internal: the operations must be called by one thread at a time
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Size_Policy = Prime_Sizing>
+class Async_HashTable
+{
+public:
+
+    typedef HashTable<Key_Type, Value_Type, Hash, Size_Policy> Table;
+
+    //Key types accepted by the operations below, see HashTable
+    template <typename K>
+    using Lookup_Key = typename Table::template Lookup_Key<K>;
+
+    //Constructor to create a hash table
+    //table_size is number of slots in the table (rounded up by the sizing policy)
+    //f is the hash functor
+    explicit Async_HashTable(int table_size, const Hash& f = Hash());
+
+
+    //Destructor
+    //Waits for the background thread, if a re-hash is in progress
+    ~Async_HashTable();
+
+
+    //Return the load factor of the current table
+    double loadFactor() const
+    {
+        return current->loadFactor();
+    }
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return delta ? nItems : current->get_number_OF_items();
+    }
+
+    //Return the total number of visited slots (during search, insert, remove, or re-hash)
+    unsigned get_total_visited_slots() const
+    {
+        return current->get_total_visited_slots() + (delta ? delta->get_total_visited_slots() : 0);
+    }
+
+    //Return the total number of call to new Item()
+    unsigned get_count_new_items() const
+    {
+        return current->get_count_new_items() + (delta ? delta->get_count_new_items() : 0);
+    }
+
+    //Return true if a re-hash is in progress
+    bool rehashing() const
+    {
+        return delta != nullptr;
+    }
+
+
+    //Return a pointer to the value associated with key
+    //If key does not exist in the table then nullptr is returned
+    const Value_Type* _find(const Key_Type& key)
+    {
+        return _find<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* _find(const K& key);
+
+
+    //Insert the Item (key, v) in the table
+    //If key already exists in the table then change the value associated with key to v
+    void _insert(const Key_Type& key, const Value_Type& v)
+    {
+        _insert<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    void _insert(const K& key, const Value_Type& v);
+
+
+    //Remove Item with key, if the item exists
+    //If an Item was removed then return true
+    //otherwise, return false
+    bool _remove(const Key_Type& key)
+    {
+        return _remove<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _remove(const K& key);
+
+
+    //Overloaded subscript operator
+    //If key is not in the table then insert a new Item = (key, Value_Type())
+    //As for HashTable, the reference is invalidated by the next insertion or removal
+    Value_Type& operator[](const Key_Type& key)
+    {
+        return operator[]<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    Value_Type& operator[](const K& key);
+
+
+    //Wait for the re-hash in progress, if any, and swap in the new table
+    void wait();
+
+
+    //Call f(key, value) for each item stored in the table
+    //During a re-hash, the items of the delta are visited last
+    template <typename Function>
+    void for_each(Function f) const;
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const Async_HashTable& T)
+    {
+        T.for_each([&os](const Key_Type& key, const Value_Type& value)
+        {
+            os << "key = " << "\"" << key << "\""
+               << setw(12) << "value = " << value << endl;
+        });
+
+        return os;
+    }
+
+
+    void disallowRehashing()
+    {
+        rehashingAllowed = false;
+    }
+
+    //Set the load factor above which the table is re-hashed, by default MAX_LOAD_FACTOR
+    void set_max_load_factor(double lf)
+    {
+        maxLoadFactor = lf;
+    }
+
+private:
+
+    //An insertion or removal made during a re-hash
+    struct Delta_Entry
+    {
+        Value_Type value;
+        bool erased;
+    };
+
+    typedef HashTable<Key_Type, Delta_Entry, Hash, Size_Policy> Delta_Table;
+
+    //Initial number of slots of the delta table
+    static constexpr int DELTA_SIZE = 64;
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Table of the operations, read only during a re-hash
+    //It never re-hashes itself
+    Table* current;
+
+    //Table built by the background thread, during a re-hash
+    Table* next = nullptr;
+
+    //Operations made during a re-hash, nullptr otherwise
+    Delta_Table* delta = nullptr;
+
+    //Number of items during a re-hash, i.e. in current and delta
+    unsigned nItems = 0;
+
+    //Builds next, and sets ready when next is built
+    thread worker;
+    atomic<bool> ready{false};
+
+    bool rehashingAllowed = true;
+    double maxLoadFactor = MAX_LOAD_FACTOR;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    //Swap in the new table if the background thread is done,
+    //then start a re-hash if the load factor is above maxLoadFactor
+    void poll()
+    {
+        if (delta && ready.load(memory_order_acquire))
+        {
+            finish();
+        }
+
+        if (!delta && rehashingAllowed && current->loadFactor() > maxLoadFactor)
+        {
+            start();
+        }
+    }
+
+    //Start the background thread, which builds next from current
+    void start();
+
+    //Build next: place the Items of current in a new table (runs in the background thread)
+    void build();
+
+    //Join the background thread, apply the delta to next, and replace current by next
+    void finish();
+
+    //Return a pointer to the value of key during a re-hash, or nullptr
+    template <typename K>
+    const Value_Type* lookup(const K& key) const
+    {
+        const Delta_Entry* d = delta->peek(key);
+
+        if (d)
+        {
+            return d->erased ? nullptr : &d->value;
+        }
+
+        return current->peek(key);
+    }
+
+    //Disable copy constructor!!
+    Async_HashTable(const Async_HashTable &) = delete;
+
+    //Disable assignment operator!!
+    const Async_HashTable& operator=(const Async_HashTable &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::Async_HashTable(int table_size, const Hash& f)
+    : current(new Table(table_size, f))
+{
+    current->disallowRehashing();
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::~Async_HashTable()
+{
+    wait();
+
+    delete current;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+const Value_Type* Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::_find(const K& key)
+{
+    poll();
+
+    return delta ? lookup(key) : current->_find(key);
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::_insert(const K& key, const Value_Type& v)
+{
+    if (delta)
+    {
+        if (!lookup(key)) nItems++;
+
+        delta->_insert(key, Delta_Entry{v, false});
+    }
+    else
+    {
+        current->_insert(key, v);
+    }
+
+    poll();
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+bool Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::_remove(const K& key)
+{
+    bool removed;
+
+    if (delta)
+    {
+        removed = lookup(key);
+
+        if (removed)
+        {
+            nItems--;
+
+            //the Item may be in current, so the removal is recorded
+            delta->_insert(key, Delta_Entry{Value_Type(), true});
+        }
+    }
+    else
+    {
+        removed = current->_remove(key);
+    }
+
+    poll();
+
+    return removed;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+Value_Type& Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::operator[](const K& key)
+{
+    //poll first: the returned reference must stay valid until the next operation
+    poll();
+
+    if (!delta)
+    {
+        //current does not re-hash itself, so the reference stays valid
+        return (*current)[key];
+    }
+
+    const Delta_Entry* d = delta->peek(key);
+
+    if (!d || d->erased)
+    {
+        //the value of current is copied to the delta, and modified there
+        const Value_Type* v = d ? nullptr : current->peek(key);
+
+        if (!v) nItems++;
+
+        delta->_insert(key, Delta_Entry{v ? *v : Value_Type(), false});
+    }
+
+    return (*delta)[key].value;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::wait()
+{
+    if (delta)
+    {
+        finish();
+    }
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename Function>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::for_each(Function f) const
+{
+    for (const Item<Key_Type, Value_Type>& item : *current)
+    {
+        //during a re-hash, an item of the delta replaces the item of current
+        if (!delta || !delta->peek(item.get_key()))
+        {
+            f(item.get_key(), item.get_value());
+        }
+    }
+
+    if (delta)
+    {
+        delta->for_each([&f](const Key_Type& key, const Delta_Entry& d)
+        {
+            if (!d.erased) f(key, d.value);
+        });
+    }
+}
+
+
+//Start the background thread, which builds next from current
+//If no thread can be started then current is re-hashed in this thread
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::start()
+{
+    nItems = current->get_number_OF_items();
+    delta = new Delta_Table(DELTA_SIZE, current->hash_function());
+    ready.store(false, memory_order_relaxed);
+
+    try
+    {
+        worker = thread([this]()
+        {
+            build();
+            ready.store(true, memory_order_release);
+        });
+    }
+    catch (const system_error&)
+    {
+        build();
+        finish();
+    }
+}
+
+
+//Build next: place the Items of current in a new table
+//current is only read: its slots and the keys of its Items
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::build()
+{
+    auto start = chrono::steady_clock::now();
+
+    //as HashTable::make_room: the load of a table with few items is mostly
+    //deleted slots, which are dropped, so the table keeps its size
+    unsigned n_slots = current->_size;
+
+    if (current->nItems > maxLoadFactor / 2 * n_slots)
+    {
+        n_slots *= 2;
+    }
+
+    next = new Table(n_slots, current->hash_function());
+    next->disallowRehashing();
+
+    for (const Item<Key_Type, Value_Type>& item : *current)
+    {
+        next->place(const_cast<Item<Key_Type, Value_Type>*>(&item));
+    }
+
+    next->nItems = current->nItems;
+
+    //the statistics of current are kept
+    next->total_visited_slots += current->total_visited_slots;
+    next->count_new_items = current->count_new_items;
+    next->probe_operations = current->probe_operations;
+    next->probe_slots = current->probe_slots;
+    copy(current->probe_histogram, current->probe_histogram + Table::PROBE_BINS, next->probe_histogram);
+
+    next->rehash_count = current->rehash_count + 1;
+    next->rehash_seconds = current->rehash_seconds
+                           + chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+//Join the background thread, apply the delta to next, and replace current by next
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void Async_HashTable<Key_Type, Value_Type, Hash, Size_Policy>::finish()
+{
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+
+    //next may re-hash itself if the delta is large
+    next->rehashingAllowed = true;
+
+    for (const Item<Key_Type, Delta_Entry>& item : *delta)
+    {
+        if (item.get_value().erased)
+        {
+            next->_remove(item.get_key());
+        }
+        else
+        {
+            next->_insert(item.get_key(), item.get_value().value);
+        }
+    }
+
+    next->rehashingAllowed = false;
+    next->total_visited_slots += delta->get_total_visited_slots();
+    next->count_new_items += delta->get_count_new_items();
+
+    delete delta;
+    delta = nullptr;
+
+    //the Items of current are now owned by next: only the slots of current are released
+    fill(current->hTable, current->hTable + current->_size, nullptr);
+    delete current;
+
+    current = next;
+    next = nullptr;
+}
+
+#endif
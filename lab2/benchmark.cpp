@@ -0,0 +1,406 @@
+/*
+  Course: TND004, Lab 2
+  Description: benchmark of the hash tables, the results are written to cout as CSV
+              Build: g++ -std=c++17 -O2 benchmark.cpp -o benchmark
+              Run:   ./benchmark [number of keys] > results.csv
+*/
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <set>
+#include <atomic>
+#include <iomanip>
+
+#include "hashTable.h"
+#include "asyncHashTable.h"
+#include "cuckooHashTable.h"
+#include "chainedHashTable.h"
+#include "hashFunctions.h"
+
+using namespace std;
+
+const unsigned SEED = 1159241;
+
+//Number of keys of a key set, if not given on the command line
+const int DEFAULT_KEYS = 100000;
+
+//Adversarial key sets are smaller: all their keys collide, so the operations take linear time
+const int MAX_ADVERSARIAL_KEYS = 4096;
+
+
+/* ********************************** *
+* Memory use                          *
+* *********************************** */
+
+//Number of bytes allocated with operator new and not yet released
+//Each block starts with its size, so that operator delete can subtract it
+//Atomic, since the background thread of Async_HashTable also allocates
+static atomic<size_t> live_bytes(0);
+
+static const size_t BLOCK_HEADER = alignof(max_align_t);
+
+void* operator new(size_t n)
+{
+    char* p = (char*) malloc(n + BLOCK_HEADER);
+
+    if (!p)
+    {
+        throw bad_alloc();
+    }
+
+    *(size_t*) p = n;
+    live_bytes.fetch_add(n, memory_order_relaxed);
+
+    return p + BLOCK_HEADER;
+}
+
+void operator delete(void* q) noexcept
+{
+    if (q)
+    {
+        char* p = (char*) q - BLOCK_HEADER;
+
+        live_bytes.fetch_sub(*(size_t*) p, memory_order_relaxed);
+        free(p);
+    }
+}
+
+void* operator new[](size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete[](void* q) noexcept
+{
+    operator delete(q);
+}
+
+void operator delete(void* q, size_t) noexcept
+{
+    operator delete(q);
+}
+
+void operator delete[](void* q, size_t) noexcept
+{
+    operator delete(q);
+}
+
+//Over-aligned types (e.g. the alignas(64) buckets of CuckooHashTable) use these overloads
+//The header takes a multiple of the alignment, so the returned block stays aligned
+static size_t aligned_header(align_val_t al)
+{
+    return max(BLOCK_HEADER, (size_t) al);
+}
+
+void* operator new(size_t n, align_val_t al)
+{
+    const size_t header = aligned_header(al);
+    const size_t bytes = (n + header + (size_t) al - 1) / (size_t) al * (size_t) al;
+
+    char* p = (char*) aligned_alloc((size_t) al, bytes);
+
+    if (!p)
+    {
+        throw bad_alloc();
+    }
+
+    *(size_t*) p = n;
+    live_bytes.fetch_add(n, memory_order_relaxed);
+
+    return p + header;
+}
+
+void operator delete(void* q, align_val_t al) noexcept
+{
+    if (q)
+    {
+        char* p = (char*) q - aligned_header(al);
+
+        live_bytes.fetch_sub(*(size_t*) p, memory_order_relaxed);
+        free(p);
+    }
+}
+
+void* operator new[](size_t n, align_val_t al)
+{
+    return operator new(n, al);
+}
+
+void operator delete[](void* q, align_val_t al) noexcept
+{
+    operator delete(q, al);
+}
+
+void operator delete(void* q, size_t, align_val_t al) noexcept
+{
+    operator delete(q, al);
+}
+
+void operator delete[](void* q, size_t, align_val_t al) noexcept
+{
+    operator delete(q, al);
+}
+
+
+/* ********************************** *
+* Key sets                            *
+* *********************************** */
+
+//A key set: the distinct keys inserted in the table, distinct keys not in the table,
+//and a stream of keys (with repetitions) counted with operator[]
+struct Key_Set
+{
+    string name;
+    vector<string> keys;
+    vector<string> misses;
+    vector<string> stream;
+};
+
+
+//Uniformly distributed 64 bits integers, written as decimal strings
+Key_Set uniform_ints(int n, mt19937_64& gen)
+{
+    Key_Set ks;
+    set<string> seen;
+
+    ks.name = "uniform_ints";
+
+    while ((int) ks.misses.size() < n)
+    {
+        string k = to_string(gen());
+
+        if (seen.insert(k).second)
+        {
+            (ks.keys.size() < (size_t) n ? ks.keys : ks.misses).push_back(k);
+        }
+    }
+
+    uniform_int_distribution<int> pick(0, n - 1);
+
+    for (int i = 0; i < n; ++i)
+    {
+        ks.stream.push_back(ks.keys[pick(gen)]);
+    }
+
+    return ks;
+}
+
+
+//Random lower-case words, the stream follows Zipf's law as the words of a text:
+//the i-th most frequent word appears with a frequency proportional to 1/i
+Key_Set zipf_words(int n, mt19937_64& gen)
+{
+    Key_Set ks;
+    set<string> seen;
+
+    ks.name = "zipf_words";
+
+    uniform_int_distribution<int> length(3, 10), letter('a', 'z');
+
+    while ((int) ks.misses.size() < n)
+    {
+        string k(length(gen), ' ');
+
+        for (char& c : k) c = letter(gen);
+
+        if (seen.insert(k).second)
+        {
+            (ks.keys.size() < (size_t) n ? ks.keys : ks.misses).push_back(k);
+        }
+    }
+
+    vector<double> cdf(n);
+    double sum = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        sum += 1.0 / (i + 1);
+        cdf[i] = sum;
+    }
+
+    uniform_real_distribution<double> u(0, sum);
+
+    for (int i = 0; i < n; ++i)
+    {
+        size_t r = lower_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin();
+
+        ks.stream.push_back(ks.keys[min(r, (size_t) n - 1)]);
+    }
+
+    return ks;
+}
+
+
+//Words with the same Horner_Hash value: 37*'b' + 'z' == 37*'c' + 'U' == 37*'d' + '0',
+//so words made of these blocks collide, whatever the sizing policy
+//The keys use the blocks "bz" and "cU", the misses also have a block "d0"
+Key_Set horner_collisions(int n, mt19937_64& gen)
+{
+    Key_Set ks;
+
+    ks.name = "horner_collisions";
+    n = min(n, MAX_ADVERSARIAL_KEYS);
+
+    unsigned blocks = 1;
+    while ((1 << blocks) < n) ++blocks;
+
+    for (int i = 0; i < n; ++i)
+    {
+        string k;
+
+        for (unsigned b = 0; b < blocks; ++b)
+        {
+            k += ((i >> b) & 1) ? "cU" : "bz";
+        }
+
+        ks.keys.push_back(k);
+
+        k.replace(0, 2, "d0");
+        ks.misses.push_back(k);
+    }
+
+    uniform_int_distribution<int> pick(0, n - 1);
+
+    for (int i = 0; i < n; ++i)
+    {
+        ks.stream.push_back(ks.keys[pick(gen)]);
+    }
+
+    shuffle(ks.keys.begin(), ks.keys.end(), gen);
+
+    return ks;
+}
+
+
+/* ********************************** *
+* Benchmark                           *
+* *********************************** */
+
+//Sum of the values found, printed at the end so that the searches are not optimized away
+static long long checksum = 0;
+
+
+//Return the time in ns per operation of calling f(keys[i]) for all keys
+template <typename Function>
+double time_per_op(const vector<string>& keys, Function f)
+{
+    auto start = chrono::steady_clock::now();
+
+    for (const string& k : keys)
+    {
+        f(k);
+    }
+
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+
+    return ns / max<size_t>(keys.size(), 1);
+}
+
+
+//Measure all operations on a Table, and write one CSV line per operation
+template <typename Table>
+void run(const string& engine, const string& sizing, const string& hash,
+         const Key_Set& ks, int initial_size, double max_load)
+{
+    size_t before = live_bytes.load(memory_order_relaxed);
+
+    Table table(initial_size);
+    table.set_max_load_factor(max_load);
+
+    vector<pair<string, double>> ns;
+
+    ns.push_back({"insert", time_per_op(ks.keys, [&](const string& k) { table._insert(k, 1); })});
+
+    size_t bytes = live_bytes.load(memory_order_relaxed) - before;
+
+    ns.push_back({"find_hit", time_per_op(ks.keys, [&](const string& k)
+    {
+        const int* v = table._find(k);
+        checksum += v ? *v : 0;
+    })});
+
+    ns.push_back({"find_miss", time_per_op(ks.misses, [&](const string& k)
+    {
+        checksum += table._find(k) ? 1 : 0;
+    })});
+
+    ns.push_back({"increment", time_per_op(ks.stream, [&](const string& k) { table[k]++; })});
+
+    ns.push_back({"remove", time_per_op(ks.keys, [&](const string& k) { checksum += table._remove(k); })});
+
+    for (const auto& op : ns)
+    {
+        cout << engine << "," << sizing << "," << hash << "," << ks.name << ","
+             << ks.keys.size() << "," << initial_size << "," << max_load << ","
+             << op.first << "," << fixed << setprecision(1) << op.second << "," << bytes << endl;
+
+        cout.unsetf(ios::fixed);
+        cout.precision(6);
+    }
+}
+
+
+//Run the benchmark of the three engines for one hash function
+template <typename Hash>
+void run_hash(const string& hash, const Key_Set& ks)
+{
+    const int n = ks.keys.size();
+
+    for (int initial_size : {7, 2 * n})
+    {
+        for (double lf : {0.25, 0.5, 0.75, 0.9})
+        {
+            run<HashTable<string, int, Hash, Prime_Sizing>>("linear", "prime", hash, ks, initial_size, lf);
+            run<HashTable<string, int, Hash, Pow2_Sizing>>("linear", "pow2", hash, ks, initial_size, lf);
+            run<HashTable<string, int, Hash, Fastrange_Sizing>>("linear", "fastrange", hash, ks, initial_size, lf);
+            run<Async_HashTable<string, int, Hash, Prime_Sizing>>("async", "prime", hash, ks, initial_size, lf);
+        }
+
+        for (double lf : {0.5, 1.0, 2.0, 4.0})
+        {
+            run<ChainedHashTable<string, int, Hash, Prime_Sizing>>("chained", "prime", hash, ks, initial_size, lf);
+            run<ChainedHashTable<string, int, Hash, Pow2_Sizing>>("chained", "pow2", hash, ks, initial_size, lf);
+            run<ChainedHashTable<string, int, Hash, Fastrange_Sizing>>("chained", "fastrange", hash, ks, initial_size, lf);
+        }
+
+        for (double lf : {0.5, 0.8, 0.95})
+        {
+            run<CuckooHashTable<string, int, Hash>>("cuckoo", "pow2", hash, ks, initial_size, lf);
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? max(atoi(argv[1]), 1) : DEFAULT_KEYS;
+
+    mt19937_64 gen(SEED);
+
+    vector<Key_Set> key_sets;
+
+    key_sets.push_back(uniform_ints(n, gen));
+    key_sets.push_back(zipf_words(n, gen));
+    key_sets.push_back(horner_collisions(n, gen));
+
+    cout << "engine,sizing,hash,key_set,n,initial_size,max_load_factor,operation,ns_per_op,bytes" << endl;
+
+    for (const Key_Set& ks : key_sets)
+    {
+        run_hash<Horner_Hash>("horner", ks);
+        run_hash<Wy_Hash>("wyhash", ks);
+        run_hash<std::hash<string>>("std_hash", ks);
+    }
+
+    cerr << "checksum = " << checksum << endl;
+
+    return 0;
+}
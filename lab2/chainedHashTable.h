@@ -0,0 +1,498 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class ChainedHashTable represents a hash table with separate chaining
+              (also known as open hashing), with the same interface as HashTable
+*/
+
+#ifndef CHAINED_HASH_TABLE_H
+#define CHAINED_HASH_TABLE_H
+
+#include "hashTable.h"
+#include "arena.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+
+const double MAX_CHAIN_LOAD_FACTOR = 2.0;
+
+
+//Template class to represent a hash table using separate chaining to resolve collisions
+//Each slot of the table is the head of a linked list (chain) of the items with that home slot
+//Thus, no slots are wasted and the load factor can be larger than 1 (MAX_CHAIN_LOAD_FACTOR)
+//The nodes of the chains are taken from a pool owned by the table: removed nodes are reused,
+//and destroying the table releases a few large blocks
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Size_Policy = Prime_Sizing>
+class ChainedHashTable
+{
+public:
+
+    //Key types accepted by _find, _insert, _remove, and operator[], see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to create a hash table
+    //table_size is number of slots in the table (rounded up by the sizing policy)
+    //f is the hash functor
+    explicit ChainedHashTable(int table_size, const Hash& f = Hash());
+
+
+    //Destructor
+    ~ChainedHashTable();
+
+
+    //Return the load factor of the table, i.e. average number of items per slot
+    double loadFactor() const
+    {
+        return (double) nItems / _size;
+    }
+
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return nItems;
+    }
+
+    //Return number of slots in the table
+    unsigned get_table_size() const
+    {
+        return _size;
+    }
+
+    //Return the total number of visited slots and nodes (during search, insert, remove, or re-hash)
+    unsigned get_total_visited_slots() const
+    {
+        return total_visited_slots;
+    }
+
+    //Return the total number of call to new Item()
+    unsigned get_count_new_items() const
+    {
+        return count_new_items;
+    }
+
+
+    //Return a pointer to the value associated with key
+    //If key does not exist in the table then nullptr is returned
+    const Value_Type* _find(const Key_Type& key)
+    {
+        return _find<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* _find(const K& key);
+
+
+    //Insert the Item (key, v) in the table
+    //If key already exists in the table then change the value associated with key to v
+    //Re-hash if the table reaches the MAX_CHAIN_LOAD_FACTOR
+    void _insert(const Key_Type& key, const Value_Type& v)
+    {
+        _insert<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    void _insert(const K& key, const Value_Type& v);
+
+
+    //Remove Item with key, if the item exists
+    //If an Item was removed then return true
+    //otherwise, return false
+    bool _remove(const Key_Type& key)
+    {
+        return _remove<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _remove(const K& key);
+
+
+    //Overloaded subscript operator
+    //If key is not in the table then insert a new Item = (key, Value_Type())
+    Value_Type& operator[](const Key_Type& key)
+    {
+        return operator[]<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    Value_Type& operator[](const K& key);
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const ChainedHashTable& T)
+    {
+        for (unsigned i = 0; i < T._size; ++i)
+        {
+            for (const Node* n = T.hTable[i]; n; n = n->next)
+            {
+                os << n->item << endl;
+            }
+        }
+
+        return os;
+    }
+
+
+    //Display the table for debug and testing purposes
+    //Thus, empty slots are also displayed
+    void display(ostream& os);
+
+
+    //Return statistics about the table and the quality of the hash function
+    //Probes count the visited nodes, and clusters are the chains
+    Table_Statistics statistics() const;
+
+
+    void disallowRehashing();
+
+    //Set the load factor above which the table grows, by default MAX_CHAIN_LOAD_FACTOR
+    void set_max_load_factor(double lf)
+    {
+        maxLoadFactor = lf;
+    }
+
+private:
+
+    //A node of a chain
+    struct Node
+    {
+        template <typename Key>
+        Node(Key&& key, const Value_Type& v, Node* n)
+            : item(std::forward<Key>(key), v), next(n) {  }
+
+        Item<Key_Type, Value_Type> item;
+        Node* next;
+    };
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Number of slots in the table, given by the sizing policy
+    unsigned _size;
+
+    //Hash functor
+    Hash h;
+
+    //Sizing policy, reduces hash values to slots
+    Size_Policy sizer;
+
+    //Number of items stored in the table
+    unsigned nItems;
+
+    //Table is an array of chains
+    Node** hTable;
+
+    //Pool of nodes
+    Pool<Node> nodes;
+
+    //Some statistics
+    unsigned total_visited_slots;  //total number of visited slots and nodes
+    unsigned count_new_items;      //number of calls to new Item()
+    bool rehashingAllowed = true;
+    double maxLoadFactor = MAX_CHAIN_LOAD_FACTOR;
+
+    //Number of nodes visited by each operation, see Table_Statistics
+    static constexpr unsigned PROBE_BINS = 32;
+    unsigned probe_histogram[PROBE_BINS] = {};
+    unsigned long long probe_operations = 0;
+    unsigned long long probe_slots = 0;
+
+    unsigned rehash_count = 0;
+    double rehash_seconds = 0;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+    void rehash();
+
+    //Return the address of the link to the node with key in chain idx
+    //(or of the null link at the end of the chain, if there is no such node)
+    template <typename K>
+    Node** locate(const K& key, unsigned idx);
+
+    //Return the home slot of key
+    template <typename K>
+    unsigned home_slot(const K& key) const
+    {
+        return sizer.slot(h(key));
+    }
+
+    //Disable copy constructor!!
+    ChainedHashTable(const ChainedHashTable &) = delete;
+
+    //Disable assignment operator!!
+    const ChainedHashTable& operator=(const ChainedHashTable &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+//Constructor to create a hash table
+//table_size number of slots in the table (rounded up by the sizing policy)
+//f is the hash functor
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::ChainedHashTable(int table_size, const Hash& f)
+    : h(f)
+{
+    _size = sizer.resize(table_size);
+    nItems = total_visited_slots = count_new_items = 0;
+
+    hTable = new Node*[_size]{nullptr};
+}
+
+
+//Destructor
+//The pool releases the memory of the nodes, the items only need to be destroyed
+//if they are not trivially destructible (e.g. string keys)
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::~ChainedHashTable()
+{
+    for (unsigned i = 0; !is_trivially_destructible<Node>::value && i < _size; ++i)
+    {
+        for (Node* n = hTable[i]; n; )
+        {
+            Node* next = n->next;
+            n->~Node();
+            n = next;
+        }
+    }
+
+    delete[] hTable;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+const Value_Type* ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_find(const K& key)
+{
+    Node* n = *locate(key, home_slot(key));
+
+    return n ? &n->item.get_value() : nullptr;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+void ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_insert(const K& key, const Value_Type& v)
+{
+    operator[](key) = v;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+bool ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_remove(const K& key)
+{
+    Node** link = locate(key, home_slot(key));
+    Node* n = *link;
+
+    if (!n)
+    {
+        return false;
+    }
+
+    *link = n->next;
+    nodes.destroy(n);
+    nItems--;
+
+    return true;
+}
+
+
+//Overloaded subscript operator
+//If key is not in the table then insert a new Item = (key, Value_Type()) first in its chain
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+Value_Type& ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::operator[](const K& key)
+{
+    unsigned idx = home_slot(key);
+    Node* n = *locate(key, idx);
+
+    if (n)
+    {
+        return n->item.get_value();
+    }
+
+    n = hTable[idx] = nodes.create(make_key<Key_Type>(key), Value_Type{}, hTable[idx]);
+
+    count_new_items++;
+    nItems++;
+
+    //re-hashing moves the nodes, not the items: n is still valid
+    if (loadFactor() > maxLoadFactor && rehashingAllowed)
+    {
+        rehash();
+    }
+
+    return n->item.get_value();
+}
+
+
+//Display the table for debug and testing purposes
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::display(ostream& os)
+{
+    os << "-------------------------------\n";
+    os << "Number of items in the table: " << get_number_OF_items() << endl;
+    os << "TAble size: " << _size << endl;
+    os << "Load factor: " << fixed << setprecision(2) << loadFactor() << endl;
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        os << setw(6) << i << ": ";
+
+        if (!hTable[i])
+        {
+            os << "null";
+        }
+
+        for (const Node* n = hTable[i]; n; n = n->next)
+        {
+            os << "[" << n->item << "]";
+
+            if (n->next) os << " -> ";
+        }
+
+        os << endl;
+    }
+
+    os << endl;
+}
+
+
+//Return statistics about the table and the quality of the hash function
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+Table_Statistics ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::statistics() const
+{
+    Table_Statistics s;
+
+    s.size = _size;
+    s.items = nItems;
+    s.deleted = 0;
+    s.load_factor = loadFactor();
+    s.tombstone_ratio = 0;
+
+    s.probe_histogram.assign(probe_histogram, probe_histogram + PROBE_BINS);
+    s.mean_probe_length = probe_operations ? (double) probe_slots / probe_operations : 0;
+
+    s.rehash_count = rehash_count;
+    s.rehash_seconds = rehash_seconds;
+
+    //the displacement of an item is its position in the chain
+    //the chi-square statistic is computed over the chain lengths
+    unsigned long long total_displacement = 0;
+    double expected = (double) nItems / _size;
+    double chi = 0;
+
+    s.max_displacement = s.max_cluster = 0;
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        unsigned length = 0;
+
+        for (const Node* n = hTable[i]; n; n = n->next)
+        {
+            total_displacement += length;
+            length++;
+        }
+
+        if (length > 0)
+        {
+            unsigned bin = 0;
+            while ((2u << bin) <= length) ++bin;
+
+            if (s.cluster_histogram.size() <= bin) s.cluster_histogram.resize(bin + 1, 0);
+
+            s.cluster_histogram[bin]++;
+            s.max_cluster = max(s.max_cluster, length);
+            s.max_displacement = max(s.max_displacement, length - 1);
+        }
+
+        if (expected > 0)
+            chi += (length - expected) * (length - expected) / expected;
+    }
+
+    s.mean_displacement = nItems ? (double) total_displacement / nItems : 0;
+    s.chi_square = (_size > 1) ? chi / (_size - 1) : 0;
+
+    return s;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::disallowRehashing()
+{
+    rehashingAllowed = false;
+}
+
+
+/* ********************************** *
+* Auxiliar member functions           *
+* *********************************** */
+
+//Double the number of slots and move the nodes to their new chains
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::rehash()
+{
+    auto start = chrono::steady_clock::now();
+
+    unsigned oldsize = _size;
+    Node** oldTable = hTable;
+
+    _size = sizer.resize(_size * 2);
+    hTable = new Node*[_size]{nullptr};
+
+    for (unsigned i = 0; i < oldsize; ++i)
+    {
+        for (Node* n = oldTable[i]; n; )
+        {
+            Node* next = n->next;
+            unsigned idx = home_slot(n->item.get_key());
+
+            total_visited_slots++;
+            n->next = hTable[idx];
+            hTable[idx] = n;
+
+            n = next;
+        }
+    }
+
+    delete[] oldTable;
+
+    rehash_count++;
+    rehash_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K>
+typename ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::Node**
+ChainedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::locate(const K& key, unsigned idx)
+{
+    Node** link = &hTable[idx];
+    unsigned visited = 1; //the slot
+
+    while (*link && !((*link)->item.get_key() == key))
+    {
+        link = &(*link)->next;
+        visited++;
+    }
+
+    total_visited_slots += visited;
+    probe_slots += visited;
+    probe_operations++;
+    probe_histogram[min(visited, PROBE_BINS) - 1]++;
+
+    return link;
+}
+
+#endif
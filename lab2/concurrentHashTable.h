@@ -0,0 +1,359 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class ConcurrentHashTable represents a hash table
+              that can be used by several threads at the same time
+*/
+
+#ifndef CONCURRENT_HASH_TABLE_H
+#define CONCURRENT_HASH_TABLE_H
+
+#include "hashTable.h"
+
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+
+//Template class to represent a thread safe hash table
+//The table is split in segments (lock striping): each segment is a HashTable
+//protected by its own mutex and a key always belongs to the same segment
+//Thus, threads working on keys of different segments do not block each other,
+//and a segment re-hashes under its own lock without stopping the other segments
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Size_Policy = Prime_Sizing>
+class ConcurrentHashTable
+{
+public:
+
+    typedef HashTable<Key_Type, Value_Type, Hash, Size_Policy> Table;
+
+    //Key types accepted by the operations below, see HashTable
+    template <typename K>
+    using Lookup_Key = typename Table::template Lookup_Key<K>;
+
+    //Constructor to create a hash table
+    //table_size is the total number of slots, shared by the segments
+    //n_segments is the number of segments (rounded up to a power of two)
+    //f is the hash functor
+    explicit ConcurrentHashTable(int table_size, unsigned n_segments = 64, const Hash& f = Hash());
+
+
+    //Destructor
+    ~ConcurrentHashTable();
+
+
+    //Return the load factor of the table, i.e. percentage of slots in use or deleted
+    double loadFactor() const;
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const;
+
+    //Return the total number of visited slots (during search, insert, remove, or re-hash)
+    unsigned get_total_visited_slots() const;
+
+    //Return the total number of call to new Item()
+    unsigned get_count_new_items() const;
+
+
+    //Copy the value associated with key to v and return true
+    //If key does not exist in the table then false is returned
+    //Note: a pointer to the value cannot be returned, since another thread may modify it
+    bool _find(const Key_Type& key, Value_Type& v)
+    {
+        return _find<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _find(const K& key, Value_Type& v);
+
+
+    //Insert the Item (key, v) in the table
+    //If key already exists in the table then change the value associated with key to v
+    void _insert(const Key_Type& key, const Value_Type& v)
+    {
+        _insert<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    void _insert(const K& key, const Value_Type& v);
+
+
+    //Remove Item with key, if the item exists
+    //If an Item was removed then return true
+    //otherwise, return false
+    bool _remove(const Key_Type& key)
+    {
+        return _remove<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _remove(const K& key);
+
+
+    //Call f(value) on the value associated with key, while holding the segment's lock
+    //If key is not in the table then a new Item = (key, Value_Type()) is inserted first
+    template <typename Function>
+    void update(const Key_Type& key, Function f)
+    {
+        update<Function, Key_Type>(key, f);
+    }
+
+    template <typename Function, typename K, typename = Lookup_Key<K>>
+    void update(const K& key, Function f);
+
+
+    //Add delta to the value associated with key and return the new value
+    //If key is not in the table then a new Item = (key, Value_Type()) is inserted first
+    Value_Type increment(const Key_Type& key, const Value_Type& delta = Value_Type(1))
+    {
+        return increment<Key_Type>(key, delta);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    Value_Type increment(const K& key, const Value_Type& delta = Value_Type(1));
+
+
+    //Call f(key, value) for each item stored in the table, segment by segment
+    //Should not be called while other threads modify the table
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (unsigned i = 0; i < nSegments; ++i)
+        {
+            segments[i].table->for_each(f);
+        }
+    }
+
+
+    //Display all items in table T to stream os
+    //Should not be called while other threads modify the table
+    friend ostream& operator<<(ostream& os, const ConcurrentHashTable& T)
+    {
+        for (unsigned i = 0; i < T.nSegments; ++i)
+        {
+            os << *T.segments[i].table;
+        }
+
+        return os;
+    }
+
+
+    void disallowRehashing();
+
+private:
+
+    //A segment is aligned to a cache line, so that locks of
+    //different segments do not share a cache line (false sharing)
+    struct alignas(64) Segment
+    {
+        mutable mutex m;
+        Table* table = nullptr;
+    };
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Hash functor, used to select the segment of a key
+    Hash h;
+
+    //Number of segments, a power of two
+    unsigned nSegments;
+
+    //Array of segments
+    Segment* segments;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    //Return the segment storing key
+    //The high bits of the mixed hash value are used, so that the choice of segment
+    //is independent of the slot chosen inside the segment
+    template <typename K>
+    Segment& segment_of(const K& key)
+    {
+        return segments[(mix64(h(key)) >> 32) & (nSegments - 1)];
+    }
+
+    //Disable copy constructor!!
+    ConcurrentHashTable(const ConcurrentHashTable &) = delete;
+
+    //Disable assignment operator!!
+    const ConcurrentHashTable& operator=(const ConcurrentHashTable &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::ConcurrentHashTable(int table_size, unsigned n_segments, const Hash& f)
+    : h(f), nSegments(1)
+{
+    while (nSegments < n_segments) nSegments <<= 1;
+
+    segments = new Segment[nSegments];
+
+    int segment_size = table_size / (int) nSegments + 1;
+
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        segments[i].table = new Table(segment_size, f);
+    }
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::~ConcurrentHashTable()
+{
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        delete segments[i].table;
+    }
+
+    delete[] segments;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+double ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::loadFactor() const
+{
+    double used = 0, slots = 0;
+
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        lock_guard<mutex> lock(segments[i].m);
+
+        unsigned n = segments[i].table->get_table_size();
+
+        used += segments[i].table->loadFactor() * n;
+        slots += n;
+    }
+
+    return (slots > 0) ? used / slots : 0;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_number_OF_items() const
+{
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        lock_guard<mutex> lock(segments[i].m);
+        n += segments[i].table->get_number_OF_items();
+    }
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_total_visited_slots() const
+{
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        lock_guard<mutex> lock(segments[i].m);
+        n += segments[i].table->get_total_visited_slots();
+    }
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_count_new_items() const
+{
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        lock_guard<mutex> lock(segments[i].m);
+        n += segments[i].table->get_count_new_items();
+    }
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+bool ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_find(const K& key, Value_Type& v)
+{
+    Segment& seg = segment_of(key);
+    lock_guard<mutex> lock(seg.m);
+
+    const Value_Type* p = seg.table->_find(key);
+
+    if (!p)
+    {
+        return false;
+    }
+
+    v = *p;
+    return true;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+void ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_insert(const K& key, const Value_Type& v)
+{
+    Segment& seg = segment_of(key);
+    lock_guard<mutex> lock(seg.m);
+
+    seg.table->_insert(key, v);
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+bool ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::_remove(const K& key)
+{
+    Segment& seg = segment_of(key);
+    lock_guard<mutex> lock(seg.m);
+
+    return seg.table->_remove(key);
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename Function, typename K, typename>
+void ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::update(const K& key, Function f)
+{
+    Segment& seg = segment_of(key);
+    lock_guard<mutex> lock(seg.m);
+
+    f((*seg.table)[key]);
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+template <typename K, typename>
+Value_Type ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::increment(const K& key, const Value_Type& delta)
+{
+    Segment& seg = segment_of(key);
+    lock_guard<mutex> lock(seg.m);
+
+    return (*seg.table)[key] += delta;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ConcurrentHashTable<Key_Type, Value_Type, Hash, Size_Policy>::disallowRehashing()
+{
+    for (unsigned i = 0; i < nSegments; ++i)
+    {
+        lock_guard<mutex> lock(segments[i].m);
+        segments[i].table->disallowRehashing();
+    }
+}
+
+#endif
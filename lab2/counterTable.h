@@ -0,0 +1,502 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class Counter_Table, an open addressing table with linear probing
+              that maps string keys to 32 bits counters, e.g. to count the words of a text
+*/
+
+#ifndef COUNTER_TABLE_H
+#define COUNTER_TABLE_H
+
+#include "hashTable.h"
+#include "arena.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+using namespace std;
+
+//Empty slots take 32 bytes, not one pointer as in HashTable, so the table is kept fuller
+//Two slots share a cache line, so the longer probes stay cheap
+const double COUNTER_MAX_LOAD_FACTOR = 0.75;
+
+
+//Template class to represent a table of counters with string keys
+//There are no Items: each slot of 32 bytes stores the key and its count
+//  - keys of at most MAX_INLINE (23) characters are stored in the slot itself,
+//    so counting a short word never allocates memory
+//  - longer keys are copied to an arena owned by the table, and the slot points to them
+//A slot also stores a 32 bits tag of the hash value, so that most slots with another key
+//are skipped without comparing the keys
+//Increment-or-insert (operator[]) does one probe: the search stops at the key or at the
+//first empty slot, where the key is then inserted (or at the first deleted slot on the way)
+//Hash is a hash functor for string_view, see hashFunctions.h
+template <typename Hash = std::hash<string_view>, typename Size_Policy = Prime_Sizing>
+class Counter_Table
+{
+public:
+
+    //Constructor to create a table
+    //table_size is number of slots in the table (rounded up by the sizing policy)
+    //f is the hash functor
+    explicit Counter_Table(int table_size, const Hash& f = Hash());
+
+
+    //Destructor
+    ~Counter_Table()
+    {
+        delete[] hTable;
+    }
+
+
+    //Return the load factor of the table, i.e. percentage of slots in use or deleted
+    double loadFactor() const
+    {
+        return (double) (nItems + nDeleted) / _size;
+    }
+
+
+    //Return number of keys stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return nItems;
+    }
+
+    //Return number of slots in the table
+    unsigned get_table_size() const
+    {
+        return _size;
+    }
+
+    //Return the total number of visited slots (during search, insert, remove, or re-hash)
+    unsigned get_total_visited_slots() const
+    {
+        return total_visited_slots;
+    }
+
+    //Return the number of keys copied to the arena, the only allocations for new keys
+    unsigned get_count_new_items() const
+    {
+        return count_long_keys;
+    }
+
+    //Return the number of bytes used by the slots and the long keys
+    size_t memory_usage() const
+    {
+        return _size * sizeof(Slot) + long_keys.get_allocated_bytes();
+    }
+
+
+    //Return a pointer to the count of key
+    //If key does not exist in the table then nullptr is returned
+    const uint32_t* _find(string_view key);
+
+
+    //Return the count of key
+    //If key is not in the table then it is inserted with count 0
+    uint32_t& operator[](string_view key);
+
+
+    //Remove key, if it exists
+    //If a key was removed then return true
+    //otherwise, return false
+    bool _remove(string_view key);
+
+
+    //Call f(key, count) for each key stored in the table, in slot order
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (unsigned i = 0; i < _size; ++i)
+        {
+            if (is_used(hTable[i]))
+            {
+                f(key_of(hTable[i]), hTable[i].count);
+            }
+        }
+    }
+
+
+    //Display all keys and counts in table T to stream os
+    friend ostream& operator<<(ostream& os, const Counter_Table& T)
+    {
+        T.for_each([&os](string_view key, uint32_t count)
+        {
+            os << "key = " << "\"" << key << "\""
+               << setw(12) << "value = " << count << endl;
+        });
+
+        return os;
+    }
+
+
+    //Return statistics about the table, see Table_Statistics
+    //Only the sizes and the probe lengths are given
+    Table_Statistics statistics() const;
+
+
+    void disallowRehashing()
+    {
+        rehashingAllowed = false;
+    }
+
+    //Set the load factor above which the table is re-hashed, by default COUNTER_MAX_LOAD_FACTOR
+    void set_max_load_factor(double lf)
+    {
+        maxLoadFactor = lf;
+    }
+
+private:
+
+    //Longest key stored in a slot
+    static constexpr unsigned MAX_INLINE = 23;
+
+    //Values of Slot::length that are not the length of an inline key
+    static constexpr uint8_t LONG_KEY = 0xfd;
+    static constexpr uint8_t DELETED = 0xfe;
+    static constexpr uint8_t EMPTY = 0xff;
+
+    //A slot, two slots in a cache line
+    //If length == LONG_KEY then key holds a pointer to the characters and their number
+    struct alignas(32) Slot
+    {
+        char key[MAX_INLINE];
+        uint8_t length;
+        uint32_t count;
+        uint32_t tag;
+    };
+
+    static_assert(sizeof(Slot) == 32, "a slot has 32 bytes");
+
+    //Key of a slot with length == LONG_KEY
+    struct Long_Key
+    {
+        const char* data;
+        uint32_t size;
+    };
+
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Number of slots in the table, given by the sizing policy
+    unsigned _size;
+
+    //Hash functor
+    Hash h;
+
+    //Sizing policy, reduces hash values to slots
+    Size_Policy sizer;
+
+    //Number of keys stored in the table
+    unsigned nItems;
+
+    //Number of slots that are marked as deleted
+    unsigned nDeleted;
+
+    Slot* hTable;
+
+    //Characters of the keys longer than MAX_INLINE
+    //The memory of removed keys is only reused when the table is destroyed
+    Arena long_keys;
+
+    //Some statistics
+    unsigned total_visited_slots;
+    unsigned count_long_keys;
+    bool rehashingAllowed = true;
+    double maxLoadFactor = COUNTER_MAX_LOAD_FACTOR;
+
+    //Number of slots visited by each operation, see Table_Statistics
+    static constexpr unsigned PROBE_BINS = 32;
+    unsigned probe_histogram[PROBE_BINS] = {};
+    unsigned long long probe_operations = 0;
+    unsigned long long probe_slots = 0;
+
+    unsigned rehash_count = 0;
+    double rehash_seconds = 0;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    static bool is_used(const Slot& s)
+    {
+        return s.length <= MAX_INLINE || s.length == LONG_KEY;
+    }
+
+    static Long_Key long_key(const Slot& s)
+    {
+        Long_Key k;
+        memcpy(&k, s.key, sizeof k);
+
+        return k;
+    }
+
+    static string_view key_of(const Slot& s)
+    {
+        if (s.length == LONG_KEY)
+        {
+            Long_Key k = long_key(s);
+            return string_view(k.data, k.size);
+        }
+
+        return string_view(s.key, s.length);
+    }
+
+    static uint32_t tag_of(size_t hv)
+    {
+        return (uint32_t) (mix64(hv) >> 32);
+    }
+
+    //Return true if slot s has key, with tag
+    static bool matches(const Slot& s, string_view key, uint32_t tag)
+    {
+        if (s.tag != tag || !is_used(s))
+        {
+            return false;
+        }
+
+        string_view k = key_of(s);
+
+        return k.size() == key.size() && memcmp(k.data(), key.data(), key.size()) == 0;
+    }
+
+    //Search key, with hash value hv
+    //Return the slot with key or, if key is not in the table, the first empty slot
+    //firstDeleted is the first deleted slot before the returned one, or NOT_FOUND
+    //If the table has no empty slot and no slot with key then NOT_FOUND is returned
+    int locate(string_view key, size_t hv, int& firstDeleted);
+
+    //Store key, with hash value hv, in the unused slot s
+    void store_key(Slot& s, string_view key, size_t hv);
+
+    //Move the keys to a new table with at least n_slots slots, deleted slots are dropped
+    void rehash(unsigned n_slots);
+
+    //Disable copy constructor!!
+    Counter_Table(const Counter_Table &) = delete;
+
+    //Disable assignment operator!!
+    const Counter_Table& operator=(const Counter_Table &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+//Constructor to create a table
+template <typename Hash, typename Size_Policy>
+Counter_Table<Hash, Size_Policy>::Counter_Table(int table_size, const Hash& f)
+    : h(f), nItems(0), nDeleted(0), total_visited_slots(0), count_long_keys(0)
+{
+    _size = sizer.resize(table_size);
+    hTable = new Slot[_size];
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        hTable[i].length = EMPTY;
+    }
+}
+
+
+//Return a pointer to the count of key
+template <typename Hash, typename Size_Policy>
+const uint32_t* Counter_Table<Hash, Size_Policy>::_find(string_view key)
+{
+    int firstDeleted;
+    int idx = locate(key, h(key), firstDeleted);
+
+    return (idx != NOT_FOUND && is_used(hTable[idx])) ? &hTable[idx].count : nullptr;
+}
+
+
+//Return the count of key, insert key with count 0 if it is not in the table
+template <typename Hash, typename Size_Policy>
+uint32_t& Counter_Table<Hash, Size_Policy>::operator[](string_view key)
+{
+    //a table without empty slots is re-hashed, even if re-hashing is not allowed
+    if ((loadFactor() > maxLoadFactor && rehashingAllowed) || nItems + nDeleted == _size)
+    {
+        rehash(_size * 2);
+    }
+
+    size_t hv = h(key);
+    int firstDeleted;
+    int idx = locate(key, hv, firstDeleted);
+
+    if (is_used(hTable[idx]))
+    {
+        return hTable[idx].count;
+    }
+
+    if (firstDeleted != NOT_FOUND)
+    {
+        idx = firstDeleted;
+        nDeleted--;
+    }
+
+    store_key(hTable[idx], key, hv);
+    nItems++;
+
+    return hTable[idx].count;
+}
+
+
+//Remove key, if it exists
+template <typename Hash, typename Size_Policy>
+bool Counter_Table<Hash, Size_Policy>::_remove(string_view key)
+{
+    int firstDeleted;
+    int idx = locate(key, h(key), firstDeleted);
+
+    if (idx == NOT_FOUND || !is_used(hTable[idx]))
+    {
+        return false;
+    }
+
+    hTable[idx].length = DELETED;
+    nItems--;
+    nDeleted++;
+
+    return true;
+}
+
+
+//Return statistics about the table
+template <typename Hash, typename Size_Policy>
+Table_Statistics Counter_Table<Hash, Size_Policy>::statistics() const
+{
+    Table_Statistics s = Table_Statistics();
+
+    s.size = _size;
+    s.items = nItems;
+    s.deleted = nDeleted;
+    s.load_factor = loadFactor();
+    s.tombstone_ratio = (double) nDeleted / _size;
+
+    s.probe_histogram.assign(probe_histogram, probe_histogram + PROBE_BINS);
+    s.mean_probe_length = probe_operations ? (double) probe_slots / probe_operations : 0;
+
+    s.rehash_count = rehash_count;
+    s.rehash_seconds = rehash_seconds;
+
+    return s;
+}
+
+
+/* ********************************** *
+* Auxiliar member functions           *
+* *********************************** */
+
+//Search key, with hash value hv
+template <typename Hash, typename Size_Policy>
+int Counter_Table<Hash, Size_Policy>::locate(string_view key, size_t hv, int& firstDeleted)
+{
+    const uint32_t tag = tag_of(hv);
+    unsigned idx = sizer.slot(hv);
+    unsigned visited = 0;
+    int result = NOT_FOUND;
+
+    firstDeleted = NOT_FOUND;
+
+    for (; visited < _size; ++visited)
+    {
+        const Slot& s = hTable[idx];
+
+        if (s.length == EMPTY || matches(s, key, tag))
+        {
+            result = idx;
+            visited++;
+            break;
+        }
+
+        if (s.length == DELETED && firstDeleted == NOT_FOUND)
+        {
+            firstDeleted = idx;
+        }
+
+        if (++idx == _size) idx = 0;
+    }
+
+    total_visited_slots += visited;
+    probe_slots += visited;
+    probe_operations++;
+    probe_histogram[min(max(visited, 1u), PROBE_BINS) - 1]++;
+
+    return result;
+}
+
+
+//Store key, with hash value hv, in the unused slot s
+template <typename Hash, typename Size_Policy>
+void Counter_Table<Hash, Size_Policy>::store_key(Slot& s, string_view key, size_t hv)
+{
+    if (key.size() <= MAX_INLINE)
+    {
+        memcpy(s.key, key.data(), key.size());
+        s.length = key.size();
+    }
+    else
+    {
+        char* data = static_cast<char*>(long_keys.allocate(key.size(), 1));
+        memcpy(data, key.data(), key.size());
+
+        Long_Key k = {data, (uint32_t) key.size()};
+        memcpy(s.key, &k, sizeof k);
+        s.length = LONG_KEY;
+
+        count_long_keys++;
+    }
+
+    s.count = 0;
+    s.tag = tag_of(hv);
+}
+
+
+//Move the keys to a new table with at least n_slots slots
+//The slots are moved as they are: the keys are hashed again, but not copied
+template <typename Hash, typename Size_Policy>
+void Counter_Table<Hash, Size_Policy>::rehash(unsigned n_slots)
+{
+    auto start = chrono::steady_clock::now();
+
+    unsigned oldsize = _size;
+    Slot* oldTable = hTable;
+
+    _size = sizer.resize(n_slots);
+    hTable = new Slot[_size];
+    nDeleted = 0;
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        hTable[i].length = EMPTY;
+    }
+
+    for (unsigned i = 0; i < oldsize; ++i)
+    {
+        if (is_used(oldTable[i]))
+        {
+            unsigned idx = sizer.slot(h(key_of(oldTable[i])));
+
+            while (total_visited_slots++, hTable[idx].length != EMPTY)
+            {
+                if (++idx == _size) idx = 0;
+            }
+
+            hTable[idx] = oldTable[i];
+        }
+    }
+
+    delete[] oldTable;
+
+    rehash_count++;
+    rehash_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+#endif
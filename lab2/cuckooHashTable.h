@@ -0,0 +1,633 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class CuckooHashTable represents a bucketized cuckoo hash table
+              with the same interface as HashTable
+*/
+
+#ifndef CUCKOO_HASH_TABLE_H
+#define CUCKOO_HASH_TABLE_H
+
+#include "hashTable.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+
+//Template class to represent a bucketized cuckoo hash table
+//Each key has two candidate buckets of 4 slots, so a search looks at most at two buckets
+//(two cache lines), while the linear probing of HashTable has no bound on the probe length
+//An insertion into two full buckets moves (kicks) an item to its other bucket, and so on,
+//until an empty slot is found. If that takes too many kicks then the table is re-hashed,
+//or, if the table is not even half full, the item left over is kept in a stash
+//A larger table does not help keys with the same hash value: they always have the same
+//two buckets, so all but 2*SLOTS of them are in the stash, which is searched linearly
+//
+//Each slot keeps an 8 bits tag of the key's hash value, so keys are only compared when the
+//tags match. The second bucket is computed from the first bucket and the tag (partial-key
+//cuckoo hashing), so items can be kicked without hashing their keys again
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Storage = Heap_Storage>
+class CuckooHashTable
+{
+public:
+
+    //Key types accepted by _find, _insert, _remove, and operator[], see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to create a hash table
+    //table_size is number of slots in the table (rounded up to a power of two number of buckets)
+    //f is the hash functor
+    explicit CuckooHashTable(int table_size, const Hash& f = Hash());
+
+
+    //Destructor
+    ~CuckooHashTable();
+
+
+    //Return the load factor of the table, i.e. percentage of slots in use
+    //The stashed items are not in a slot
+    double loadFactor() const
+    {
+        return (double) (nItems - stash.size()) / (nBuckets * SLOTS);
+    }
+
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return nItems;
+    }
+
+    //Return number of slots in the table
+    unsigned get_table_size() const
+    {
+        return nBuckets * SLOTS;
+    }
+
+    //Return the total number of visited buckets (during search, insert, remove, or re-hash)
+    unsigned get_total_visited_slots() const
+    {
+        return total_visited_buckets;
+    }
+
+    //Return the total number of call to new Item()
+    unsigned get_count_new_items() const
+    {
+        return count_new_items;
+    }
+
+    //Return the number of items in the stash, i.e. not in one of their buckets
+    unsigned get_stash_size() const
+    {
+        return stash.size();
+    }
+
+
+    //Return a pointer to the value associated with key
+    //If key does not exist in the table then nullptr is returned
+    const Value_Type* _find(const Key_Type& key)
+    {
+        return _find<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* _find(const K& key);
+
+
+    //Insert the Item (key, v) in the table
+    //If key already exists in the table then change the value associated with key to v
+    void _insert(const Key_Type& key, const Value_Type& v)
+    {
+        _insert<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    void _insert(const K& key, const Value_Type& v);
+
+
+    //Remove Item with key, if the item exists
+    //If an Item was removed then return true
+    //otherwise, return false
+    bool _remove(const Key_Type& key)
+    {
+        return _remove<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _remove(const K& key);
+
+
+    //Overloaded subscript operator
+    //If key is not in the table then insert a new Item = (key, Value_Type())
+    Value_Type& operator[](const Key_Type& key)
+    {
+        return operator[]<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    Value_Type& operator[](const K& key);
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const CuckooHashTable& T)
+    {
+        for (unsigned b = 0; b < T.nBuckets; ++b)
+        {
+            for (unsigned j = 0; j < SLOTS; ++j)
+            {
+                if (T.buckets[b].items[j])
+                {
+                    os << *T.buckets[b].items[j] << endl;
+                }
+            }
+        }
+
+        for (const Item<Key_Type, Value_Type>* p : T.stash)
+        {
+            os << *p << endl;
+        }
+
+        return os;
+    }
+
+
+    //Display the table for debug and testing purposes
+    //Thus, empty slots are also displayed
+    void display(ostream& os);
+
+    //Do not grow the table when it is nearly full
+    //Note: an item left over after MAX_KICKS kicks is then stashed
+    void disallowRehashing();
+
+    //Set the load factor above which the table grows, by default MAX_CUCKOO_LOAD
+    void set_max_load_factor(double lf)
+    {
+        maxLoadFactor = lf;
+    }
+
+private:
+
+    //Number of slots of a bucket
+    static constexpr unsigned SLOTS = 4;
+
+    //Maximum number of kicks of an insertion before the table is re-hashed
+    static constexpr unsigned MAX_KICKS = 500;
+
+    //Maximum load factor, above it the table grows
+    static constexpr double MAX_CUCKOO_LOAD = 0.95;
+
+    //Load factor below which an insertion that reaches MAX_KICKS does not re-hash,
+    //the item left over is stashed instead
+    static constexpr double MIN_KICK_REHASH_LOAD = 0.5;
+
+    //A bucket fits in one cache line
+    //tags[j] == 0 marks an empty slot
+    struct alignas(64) Bucket
+    {
+        uint8_t tags[SLOTS];
+        Item<Key_Type, Value_Type>* items[SLOTS];
+    };
+
+    //Location of a key: its tag and two buckets
+    struct Location
+    {
+        uint8_t tag;
+        unsigned b1, b2;
+    };
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Number of buckets, a power of two
+    unsigned nBuckets;
+
+    //Hash functor
+    Hash h;
+
+    //Storage policy, allocates the Items
+    Storage store;
+
+    //Number of items stored in the table
+    unsigned nItems;
+
+    Bucket* buckets;
+
+    //Items that could not be stored in one of their buckets
+    vector<Item<Key_Type, Value_Type>*> stash;
+
+    //Some statistics
+    unsigned total_visited_buckets;  //total number of visited buckets
+    unsigned count_new_items;        //number of calls to new Item()
+    bool rehashingAllowed = true;
+    double maxLoadFactor = MAX_CUCKOO_LOAD;
+
+    //State of the generator choosing the items to kick
+    uint64_t kick_state = 0x9e3779b97f4a7c15ull;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    template <typename K>
+    Location locate(const K& key) const
+    {
+        uint64_t hv = mix64(h(key));
+        uint8_t tag = (uint8_t) (hv >> 56) | 1; //never 0
+
+        unsigned b1 = hv & (nBuckets - 1);
+
+        return {tag, b1, alt_bucket(b1, tag)};
+    }
+
+    //Return the other bucket of an item with the given tag, stored in bucket b
+    unsigned alt_bucket(unsigned b, uint8_t tag) const
+    {
+        return (b ^ (tag * 0x5bd1e995u)) & (nBuckets - 1);
+    }
+
+    //Return the item with key, or nullptr
+    template <typename K>
+    Item<Key_Type, Value_Type>* lookup(const K& key, const Location& loc);
+
+    //Store p in an empty slot of bucket b, return false if b is full
+    bool put(unsigned b, uint8_t tag, Item<Key_Type, Value_Type>* p);
+
+    //Store the new item p, kicking other items if needed
+    //Return false, and an item that could not be stored in p, if MAX_KICKS was reached
+    bool add(Item<Key_Type, Value_Type>*& p, Location loc);
+
+    //Double the number of buckets and move the items, plus item p if not nullptr
+    //The items that cannot be stored are stashed
+    void rehash(Item<Key_Type, Value_Type>* p = nullptr);
+
+    //Return the position of the item with key in the stash, or stash.size()
+    template <typename K>
+    size_t find_stashed(const K& key) const
+    {
+        size_t i = 0;
+
+        while (i < stash.size() && !(stash[i]->get_key() == key)) ++i;
+
+        return i;
+    }
+
+    //Store the new item p, whose key has location loc, re-hashing if needed
+    void store_item(Item<Key_Type, Value_Type>* p, const Location& loc);
+
+    //Disable copy constructor!!
+    CuckooHashTable(const CuckooHashTable &) = delete;
+
+    //Disable assignment operator!!
+    const CuckooHashTable& operator=(const CuckooHashTable &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+//Constructor to create a hash table
+//table_size number of slots in the table
+//f is the hash functor
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::CuckooHashTable(int table_size, const Hash& f)
+    : nBuckets(1), h(f)
+{
+    while (nBuckets * SLOTS < (unsigned) table_size) nBuckets <<= 1;
+
+    nItems = total_visited_buckets = count_new_items = 0;
+
+    buckets = new Bucket[nBuckets]();
+}
+
+
+//Destructor
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::~CuckooHashTable()
+{
+    for (unsigned b = 0; Storage::template needs_free<Key_Type, Value_Type> && b < nBuckets; ++b)
+    {
+        for (unsigned j = 0; j < SLOTS; ++j)
+        {
+            if (buckets[b].items[j])
+            {
+                store.free_item(buckets[b].items[j]);
+            }
+        }
+    }
+
+    for (unsigned i = 0; Storage::template needs_free<Key_Type, Value_Type> && i < stash.size(); ++i)
+    {
+        store.free_item(stash[i]);
+    }
+
+    delete[] buckets;
+}
+
+
+//Return a pointer to the value associated with key
+//If key does not exist in the table then nullptr is returned
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+template <typename K, typename>
+const Value_Type* CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::_find(const K& key)
+{
+    Item<Key_Type, Value_Type>* p = lookup(key, locate(key));
+
+    return p ? &p->get_value() : nullptr;
+}
+
+
+//Insert the Item (key, v) in the table
+//If key already exists in the table then change the value associated with key to v
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+template <typename K, typename>
+void CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::_insert(const K& key, const Value_Type& v)
+{
+    Location loc = locate(key);
+    Item<Key_Type, Value_Type>* p = lookup(key, loc);
+
+    if (p)
+    {
+        p->set_value(v);
+        return;
+    }
+
+    store_item(store.template make_item<Key_Type, Value_Type>(make_key<Key_Type>(key), v), loc);
+}
+
+
+//Remove Item with key, if the item exists
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+template <typename K, typename>
+bool CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::_remove(const K& key)
+{
+    Location loc = locate(key);
+
+    for (unsigned b : {loc.b1, loc.b2})
+    {
+        total_visited_buckets++;
+
+        Bucket& bucket = buckets[b];
+
+        for (unsigned j = 0; j < SLOTS; ++j)
+        {
+            if (bucket.tags[j] == loc.tag && bucket.items[j]->get_key() == key)
+            {
+                store.free_item(bucket.items[j]);
+                bucket.items[j] = nullptr;
+                bucket.tags[j] = 0;
+                nItems--;
+
+                return true;
+            }
+        }
+    }
+
+    size_t i = find_stashed(key);
+
+    if (i < stash.size())
+    {
+        store.free_item(stash[i]);
+        stash[i] = stash.back();
+        stash.pop_back();
+        nItems--;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+//Overloaded subscript operator
+//If key is not in the table then insert a new Item = (key, Value_Type())
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+template <typename K, typename>
+Value_Type& CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::operator[](const K& key)
+{
+    Location loc = locate(key);
+    Item<Key_Type, Value_Type>* p = lookup(key, loc);
+
+    if (!p)
+    {
+        //the item is not moved when other items are kicked, so the reference stays valid
+        p = store.template make_item<Key_Type, Value_Type>(make_key<Key_Type>(key), Value_Type{});
+        store_item(p, loc);
+    }
+
+    return p->get_value();
+}
+
+
+//Display the table for debug and testing purposes
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+void CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::display(ostream& os)
+{
+    os << "-------------------------------\n";
+    os << "Number of items in the table: " << get_number_OF_items() << endl;
+    os << "Number of buckets: " << nBuckets << endl;
+    os << "Load factor: " << fixed << setprecision(2) << loadFactor() << endl;
+
+    for (unsigned b = 0; b < nBuckets; ++b)
+    {
+        for (unsigned j = 0; j < SLOTS; ++j)
+        {
+            os << setw(6) << b << "." << j << ": ";
+
+            if (!buckets[b].items[j])
+            {
+                os << "null" << endl;
+            }
+            else
+            {
+                Location loc = locate(buckets[b].items[j]->get_key());
+
+                os << *buckets[b].items[j]
+                   << "  (" << loc.b1 << ", " << loc.b2 << ")" << endl;
+            }
+        }
+    }
+
+    for (const Item<Key_Type, Value_Type>* p : stash)
+    {
+        os << setw(8) << "stash" << ": " << *p << endl;
+    }
+
+    os << endl;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+void CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::disallowRehashing()
+{
+    rehashingAllowed = false;
+}
+
+
+/* ********************************** *
+* Auxiliar member functions           *
+* *********************************** */
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+template <typename K>
+Item<Key_Type, Value_Type>* CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::lookup(const K& key, const Location& loc)
+{
+    for (unsigned b : {loc.b1, loc.b2})
+    {
+        total_visited_buckets++;
+
+        const Bucket& bucket = buckets[b];
+
+        for (unsigned j = 0; j < SLOTS; ++j)
+        {
+            if (bucket.tags[j] == loc.tag && bucket.items[j]->get_key() == key)
+            {
+                return bucket.items[j];
+            }
+        }
+    }
+
+    if (!stash.empty())
+    {
+        size_t i = find_stashed(key);
+
+        return (i < stash.size()) ? stash[i] : nullptr;
+    }
+
+    return nullptr;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+bool CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::put(unsigned b, uint8_t tag, Item<Key_Type, Value_Type>* p)
+{
+    Bucket& bucket = buckets[b];
+
+    for (unsigned j = 0; j < SLOTS; ++j)
+    {
+        if (!bucket.tags[j])
+        {
+            bucket.tags[j] = tag;
+            bucket.items[j] = p;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//Store the new item p, kicking other items if needed
+//A random item of the full bucket is swapped with p, then p is the kicked item
+//which is moved to its other bucket
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+bool CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::add(Item<Key_Type, Value_Type>*& p, Location loc)
+{
+    if (put(loc.b1, loc.tag, p) || put(loc.b2, loc.tag, p))
+    {
+        return true;
+    }
+
+    unsigned b = loc.b1;
+    uint8_t tag = loc.tag;
+
+    for (unsigned kick = 0; kick < MAX_KICKS; ++kick)
+    {
+        total_visited_buckets++;
+
+        kick_state ^= kick_state << 13;
+        kick_state ^= kick_state >> 7;
+        kick_state ^= kick_state << 17;
+
+        unsigned j = kick_state % SLOTS;
+
+        swap(tag, buckets[b].tags[j]);
+        swap(p, buckets[b].items[j]);
+
+        b = alt_bucket(b, tag);
+
+        if (put(b, tag, p))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//Store the new item p
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+void CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::store_item(Item<Key_Type, Value_Type>* p, const Location& loc)
+{
+    count_new_items++;
+    nItems++;
+
+    if (loadFactor() > maxLoadFactor && rehashingAllowed)
+    {
+        rehash(p);
+    }
+    else if (!add(p, loc))
+    {
+        //p is now another item, kicked out of the table
+        //in a table less than half full, the kicks failed because of colliding keys,
+        //which a larger table would not separate
+        if (loadFactor() < MIN_KICK_REHASH_LOAD || !rehashingAllowed)
+        {
+            stash.push_back(p);
+        }
+        else
+        {
+            rehash(p);
+        }
+    }
+}
+
+
+//Double the number of buckets and move the items, plus item p that is not in the table
+//The stashed items are stored again, and the items that cannot be stored are stashed:
+//the number of buckets is doubled once, whatever the keys
+template <typename Key_Type, typename Value_Type, typename Hash, typename Storage>
+void CuckooHashTable<Key_Type, Value_Type, Hash, Storage>::rehash(Item<Key_Type, Value_Type>* p)
+{
+    vector<Item<Key_Type, Value_Type>*> items;
+    items.reserve(nItems);
+
+    for (unsigned b = 0; b < nBuckets; ++b)
+    {
+        for (unsigned j = 0; j < SLOTS; ++j)
+        {
+            if (buckets[b].items[j]) items.push_back(buckets[b].items[j]);
+        }
+    }
+
+    items.insert(items.end(), stash.begin(), stash.end());
+    stash.clear();
+
+    if (p) items.push_back(p);
+
+    delete[] buckets;
+
+    nBuckets *= 2;
+    buckets = new Bucket[nBuckets]();
+
+    for (Item<Key_Type, Value_Type>* q : items)
+    {
+        if (!add(q, locate(q->get_key())))
+        {
+            //q is now the item left over by the kicks
+            stash.push_back(q);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class Frozen_Table, a read-only table with a minimal perfect hash function,
+              built from a HashTable by freeze()
+*/
+
+#ifndef FROZEN_TABLE_H
+#define FROZEN_TABLE_H
+
+#include "hashTable.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+
+//Template class to represent a read-only table with a minimal perfect hash function
+//The n keys are stored in exactly n slots, without collisions: a search computes one slot
+//and compares one key, and no slot is empty
+//
+//The perfect hash function is built by "hash and displace" (CHD, PTHash): the keys are
+//split in buckets of about BUCKET_LOAD keys, and each bucket gets a pilot value such that
+//slot(key) = reduce(mix(hash(key) ^ pilot), n) sends the keys of the bucket to free slots
+//The largest buckets are placed first, when most slots are still free
+//
+//Two keys with the same hash value are always sent to the same slot, whatever the pilot
+//and the seed: only one of them is placed, the others are stored in a small overflow array,
+//sorted by hash value, which is searched only if the slot has another key
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>>
+class Frozen_Table
+{
+public:
+
+    //Key types accepted by _find, see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to create a table with the n items (keys[i], values[i])
+    //The keys must be distinct
+    //If no perfect hash function is found after MAX_SEEDS seeds then runtime_error is thrown
+    Frozen_Table(vector<Key_Type> keys, vector<Value_Type> values, const Hash& f = Hash());
+
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return keys.size() + overflow.size();
+    }
+
+
+    //Return a pointer to the value associated with key
+    //If key does not exist in the table then nullptr is returned
+    const Value_Type* _find(const Key_Type& key) const
+    {
+        return _find<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* _find(const K& key) const
+    {
+        if (keys.empty())
+        {
+            return nullptr;
+        }
+
+        uint64_t x = mix64(h(key));
+        unsigned idx = slot(x);
+
+        if (keys[idx] == key)
+        {
+            return &values[idx];
+        }
+
+        return overflow.empty() ? nullptr : find_overflow(x, key);
+    }
+
+
+    //Call f(key, value) for each item stored in the table
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            f(keys[i], values[i]);
+        }
+
+        for (const Overflow_Item& item : overflow)
+        {
+            f(item.key, item.value);
+        }
+    }
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const Frozen_Table& T)
+    {
+        T.for_each([&os](const Key_Type& key, const Value_Type& v)
+        {
+            os << "key = " << "\"" << key << "\""
+               << setw(12) << "value = " << v << endl;
+        });
+
+        return os;
+    }
+
+private:
+
+    //Average number of keys per bucket
+    static constexpr unsigned BUCKET_LOAD = 4;
+
+    //Number of pilot values tried for a bucket before the seed is changed
+    static constexpr uint32_t MAX_PILOT = 1u << 28;
+
+    //Number of seeds tried before the construction fails
+    static constexpr unsigned MAX_SEEDS = 16;
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    Hash h;
+
+    //Seed, changed if no pilot is found for a bucket
+    uint64_t seed = 0;
+
+    //The pilot value of each bucket
+    vector<uint32_t> pilots;
+
+    //keys[i] is stored in slot i, with value values[i]
+    vector<Key_Type> keys;
+    vector<Value_Type> values;
+
+    //An item whose mixed hash value is the one of a key in the slots
+    struct Overflow_Item
+    {
+        uint64_t hash;
+        Key_Type key;
+        Value_Type value;
+    };
+
+    //Items that have the hash value of another item, sorted by hash value
+    vector<Overflow_Item> overflow;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    //Return a number in [0, n) from the high bits of x (Lemire's reduction)
+    static unsigned reduce(uint64_t x, size_t n)
+    {
+        return (unsigned) (((__uint128_t) x * n) >> 64);
+    }
+
+    //Return the bucket of a key with mixed hash value x
+    unsigned bucket(uint64_t x) const
+    {
+        return reduce(x ^ seed, pilots.size());
+    }
+
+    //Return the slot of a key with mixed hash value x, in a bucket with pilot p
+    unsigned slot(uint64_t x, uint32_t p) const
+    {
+        return reduce(mix64(x ^ seed ^ (p * 0x9e3779b97f4a7c15ull)), keys.size());
+    }
+
+    unsigned slot(uint64_t x) const
+    {
+        return slot(x, pilots[bucket(x)]);
+    }
+
+    //Find the pilots of all buckets, return false if some bucket has none
+    bool build(const vector<uint64_t>& hv);
+
+    //Return a pointer to the value of key, with mixed hash value x, in the overflow array
+    template <typename K>
+    const Value_Type* find_overflow(uint64_t x, const K& key) const
+    {
+        auto it = lower_bound(overflow.begin(), overflow.end(), x, [](const Overflow_Item& item, uint64_t hv)
+        {
+            return item.hash < hv;
+        });
+
+        for (; it != overflow.end() && it->hash == x; ++it)
+        {
+            if (it->key == key)
+            {
+                return &it->value;
+            }
+        }
+
+        return nullptr;
+    }
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+template <typename Key_Type, typename Value_Type, typename Hash>
+Frozen_Table<Key_Type, Value_Type, Hash>::Frozen_Table(vector<Key_Type> k, vector<Value_Type> v, const Hash& f)
+    : h(f)
+{
+    const size_t n = k.size();
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    vector<uint64_t> hv(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        hv[i] = mix64(h(k[i]));
+    }
+
+    //keys with the same hash value cannot be separated by any pilot: the first one
+    //is placed by the perfect hash function, the others go to the overflow array
+    vector<unsigned> order(n);
+
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+
+    stable_sort(order.begin(), order.end(), [&hv](unsigned a, unsigned b)
+    {
+        return hv[a] < hv[b];
+    });
+
+    vector<unsigned> placed_items;
+    vector<uint64_t> placed_hv;
+
+    for (size_t j = 0; j < n; ++j)
+    {
+        unsigned i = order[j];
+
+        if (j > 0 && hv[i] == hv[order[j - 1]])
+        {
+            overflow.push_back(Overflow_Item{hv[i], std::move(k[i]), std::move(v[i])});
+        }
+        else
+        {
+            placed_items.push_back(i);
+            placed_hv.push_back(hv[i]);
+        }
+    }
+
+    const size_t m = placed_items.size();
+
+    keys.resize(m);
+    pilots.assign((m + BUCKET_LOAD - 1) / BUCKET_LOAD, 0);
+
+    for (unsigned tries = 1; !build(placed_hv); ++tries)
+    {
+        if (tries == MAX_SEEDS)
+        {
+            throw runtime_error("Frozen_Table: no perfect hash function found");
+        }
+
+        seed = mix64(seed + 1);
+    }
+
+    //move each item to its slot
+    vector<Value_Type> placed(m);
+
+    for (size_t j = 0; j < m; ++j)
+    {
+        unsigned idx = slot(placed_hv[j]);
+
+        keys[idx] = std::move(k[placed_items[j]]);
+        placed[idx] = std::move(v[placed_items[j]]);
+    }
+
+    values = std::move(placed);
+}
+
+
+//Find the pilots of all buckets
+template <typename Key_Type, typename Value_Type, typename Hash>
+bool Frozen_Table<Key_Type, Value_Type, Hash>::build(const vector<uint64_t>& hv)
+{
+    const size_t n = hv.size();
+    const size_t m = pilots.size();
+
+    //the keys of each bucket, stored contiguously: bucket b has keys members[first[b]..first[b+1]-1]
+    vector<unsigned> first(m + 1, 0), members(n);
+
+    for (size_t i = 0; i < n; ++i) first[bucket(hv[i]) + 1]++;
+    for (size_t b = 0; b < m; ++b) first[b + 1] += first[b];
+
+    vector<unsigned> next(first.begin(), first.end() - 1);
+
+    for (size_t i = 0; i < n; ++i) members[next[bucket(hv[i])]++] = i;
+
+    //largest buckets first
+    vector<unsigned> order(m);
+
+    for (size_t b = 0; b < m; ++b) order[b] = b;
+
+    stable_sort(order.begin(), order.end(), [&first](unsigned a, unsigned b)
+    {
+        return first[a + 1] - first[a] > first[b + 1] - first[b];
+    });
+
+    vector<bool> taken(n, false);
+    vector<unsigned> slots;
+
+    for (unsigned b : order)
+    {
+        unsigned size = first[b + 1] - first[b];
+
+        if (size == 0)
+        {
+            break;
+        }
+
+        bool found = false;
+
+        for (uint32_t p = 0; !found && p < MAX_PILOT; ++p)
+        {
+            slots.clear();
+            found = true;
+
+            for (unsigned j = first[b]; found && j < first[b + 1]; ++j)
+            {
+                unsigned idx = slot(hv[members[j]], p);
+
+                //the slot must be free, and not used by another key of the bucket
+                found = !taken[idx] && find(slots.begin(), slots.end(), idx) == slots.end();
+                slots.push_back(idx);
+            }
+
+            if (found)
+            {
+                pilots[b] = p;
+
+                for (unsigned idx : slots) taken[idx] = true;
+            }
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* ********************************** *
+* Function freeze                     *
+* *********************************** */
+
+//Return a Frozen_Table with the items of table
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+Frozen_Table<Key_Type, Value_Type, Hash> freeze(const HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>& table)
+{
+    vector<Key_Type> keys;
+    vector<Value_Type> values;
+
+    keys.reserve(table.get_number_OF_items());
+    values.reserve(table.get_number_OF_items());
+
+    table.for_each([&](const Key_Type& key, const Value_Type& v)
+    {
+        keys.push_back(key);
+        values.push_back(v);
+    });
+
+    return Frozen_Table<Key_Type, Value_Type, Hash>(std::move(keys), std::move(values), table.hash_function());
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+  Course: TND004, Lab 2
+  Description: hash functors to be used with template class HashTable
+              A hash functor receives the key by const reference and returns
+              a full-width hash value; the reduction to a slot is done by the table
+              The string hashes are transparent: string, string_view, and const char*
+              keys give the same hash value
+              The helpers for heterogeneous lookup, shared by all tables, are defined here too
+*/
+
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+
+using namespace std;
+
+
+/* ********************************** *
+* Heterogeneous lookup                *
+* *********************************** */
+
+//A hash functor is transparent if it declares the type is_transparent
+//It can then hash other types than Key_Type, e.g. string_view or const char* for string keys,
+//and give the same value as for the equal Key_Type
+template <typename H, typename = void>
+struct is_transparent_hash : false_type { };
+
+template <typename H>
+struct is_transparent_hash<H, void_t<typename H::is_transparent>> : true_type { };
+
+
+//Key types K accepted by the lookups of a table with keys Key_Type and hash functor Hash:
+//Key_Type itself, or any type if Hash is transparent
+//A table declares template <typename K> using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+template <typename K, typename Key_Type, typename Hash>
+using Lookup_Key_For = enable_if_t<is_same<K, Key_Type>::value || is_transparent_hash<Hash>::value>;
+
+
+//Type returned by make_key: a reference if K is Key_Type, otherwise a new Key_Type
+template <typename Key_Type, typename K>
+using Made_Key = conditional_t<is_same<K, Key_Type>::value, const Key_Type&, Key_Type>;
+
+//Return key as a Key_Type, e.g. to store a key found with a string_view
+//A new Key_Type is only created if key has another type
+template <typename Key_Type, typename K>
+Made_Key<Key_Type, K> make_key(const K& key)
+{
+    return static_cast<Made_Key<Key_Type, K>>(key);
+}
+
+
+//Hash function for English words
+//Polynomial accumulation
+//the Horner's rule is used to compute the value
+//See pag. 213 of course book
+struct Horner_Hash
+{
+    typedef void is_transparent;
+
+    size_t operator()(string_view s) const
+    {
+        unsigned hashVal = 0;
+
+        for(unsigned i = 0; i < s.length(); i++)
+            hashVal = 37 * hashVal + s[i];
+
+        return hashVal;
+    }
+};
+
+
+/* ********************************** *
+* wyhash-style string hash            *
+* *********************************** */
+
+//Multiply a and b to a 128 bits number and fold the two halves
+inline uint64_t wy_mum(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t) a * b;
+
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+//Read k <= 8 bytes starting at p
+inline uint64_t wy_read(const char* p, size_t k)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, k);
+
+    return v;
+}
+
+//Fast hash for strings, reads 16 bytes per step
+//The seed makes the functor stateful, e.g. to get independent hash functions
+struct Wy_Hash
+{
+    typedef void is_transparent;
+
+    explicit Wy_Hash(uint64_t s = 0)
+        : seed(s) {  }
+
+    size_t operator()(string_view s) const
+    {
+        const uint64_t s0 = 0xa0761d6478bd642full;
+        const uint64_t s1 = 0xe7037ed1a0b428dbull;
+
+        const char* p = s.data();
+        size_t n = s.length();
+        uint64_t h = seed ^ s0;
+
+        while (n > 16)
+        {
+            h = wy_mum(wy_read(p, 8) ^ s1, wy_read(p + 8, 8) ^ h);
+            p += 16;
+            n -= 16;
+        }
+
+        uint64_t a = wy_read(p, n < 8 ? n : 8);
+        uint64_t b = n > 8 ? wy_read(p + 8, n - 8) : 0;
+
+        return wy_mum(s1 ^ s.length(), wy_mum(a ^ s1, b ^ h));
+    }
+
+    uint64_t seed;
+};
+
+#endif
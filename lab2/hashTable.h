@@ -6,36 +6,359 @@
               (also known as closed_hashing) with linear probing
 */
 
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
 #include "Item.h"
+#include "itemStorage.h"
+#include "hashFunctions.h"
 
 #include <iostream>
 #include <iomanip>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <iterator>
 
 using namespace std;
 
 const int NOT_FOUND = -1;
 const double MAX_LOAD_FACTOR = 0.5;
 
+//Ratio of deleted slots above which the deleted slots are purged, without growing the table
+const double MAX_DELETED_RATIO = 0.25;
+
+//Load factor of the items below which the table shrinks (low-water mark)
+//The table shrinks to a load factor of MAX_LOAD_FACTOR/2, half-way between the two marks,
+//so that a few insertions or deletions do not make it grow and shrink again (hysteresis)
+const double MIN_LOAD_FACTOR = 0.125;
+
+//Largest max load factor of an open addressing table, so that probes end at an empty slot
+const double MAX_USABLE_LOAD_FACTOR = 0.95;
+
 struct idxPair {
     int matchOrEmptyIdx;
     int firstDeletedIdx;
 };
 
+
+/* ********************************** *
+* Functions to find prime numbers     *
+* *********************************** */
+
+//Return b^e mod n
+inline uint32_t pow_mod( uint64_t b, uint32_t e, uint32_t n )
+{
+    uint64_t r = 1;
+
+    for( b %= n; e > 0; e >>= 1, b = b * b % n )
+        if( e & 1 )
+            r = r * b % n;
+
+    return (uint32_t) r;
+}
+
+
+//Test if a number is prime
+//Miller-Rabin test with the bases 2, 7, and 61, which is exact for all 32 bits numbers
+inline bool isPrime( int n )
+{
+    if( n < 2 )
+        return false;
+
+    for( int p : {2, 3, 5, 7, 11, 13, 61} )
+        if( n % p == 0 )
+            return n == p;
+
+    uint32_t d = n - 1;
+    int s = 0;
+
+    for(; d % 2 == 0; d /= 2, s++ );
+
+    for( uint32_t a : {2u, 7u, 61u} )
+    {
+        uint64_t x = pow_mod( a, d, n );
+
+        if( x == 1 || x == (uint64_t) n - 1 )
+            continue;
+
+        //n is prime only if squaring x reaches n - 1
+        for( int i = 1; i < s && x != (uint64_t) n - 1; i++ )
+            x = x * x % n;
+
+        if( x != (uint64_t) n - 1 )
+            return false;
+    }
+
+    return true;
+}
+
+
+//Return a prime number at least as large as n
+inline int nextPrime( int n )
+{
+    if( n % 2 == 0 )
+        n++;
+
+    for(; !isPrime( n ); n += 2 );
+
+    return n;
+}
+
+
+//Table sizes used by Prime_Sizing: all primes below 100, then primes about 10% apart
+//(each one is the first prime after 1.1 times the previous one), up to the largest 32 bits prime
+const uint32_t GROWTH_PRIMES[] =
+{
+    2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u,
+    23u, 29u, 31u, 37u, 41u, 43u, 47u, 53u,
+    59u, 61u, 67u, 71u, 73u, 79u, 83u, 89u,
+    97u, 107u, 127u, 149u, 167u, 191u, 211u, 233u,
+    257u, 283u, 313u, 347u, 383u, 431u, 479u, 541u,
+    599u, 659u, 727u, 809u, 907u, 1009u, 1117u, 1229u,
+    1361u, 1499u, 1657u, 1823u, 2011u, 2213u, 2437u, 2683u,
+    2953u, 3251u, 3581u, 3943u, 4339u, 4783u, 5273u, 5801u,
+    6389u, 7039u, 7753u, 8537u, 9391u, 10331u, 11369u, 12511u,
+    13763u, 15149u, 16673u, 18341u, 20177u, 22229u, 24469u, 26921u,
+    29629u, 32603u, 35869u, 39461u, 43411u, 47777u, 52561u, 57829u,
+    63617u, 69991u, 76991u, 84691u, 93169u, 102497u, 112757u, 124067u,
+    136481u, 150131u, 165161u, 181693u, 199873u, 219871u, 241861u, 266051u,
+    292661u, 321947u, 354143u, 389561u, 428531u, 471389u, 518533u, 570389u,
+    627433u, 690187u, 759223u, 835207u, 918733u, 1010617u, 1111687u, 1222889u,
+    1345207u, 1479733u, 1627723u, 1790501u, 1969567u, 2166529u, 2383219u, 2621551u,
+    2883733u, 3172123u, 3489347u, 3838283u, 4222117u, 4644329u, 5108767u, 5619667u,
+    6181639u, 6799811u, 7479803u, 8227787u, 9050599u, 9955697u, 10951273u, 12046403u,
+    13251047u, 14576161u, 16033799u, 17637203u, 19400929u, 21341053u, 23475161u, 25822679u,
+    28404989u, 31245491u, 34370053u, 37807061u, 41587807u, 45746593u, 50321261u, 55353391u,
+    60888739u, 66977621u, 73675391u, 81042947u, 89147249u, 98061979u, 107868203u, 118655027u,
+    130520531u, 143572609u, 157929907u, 173722907u, 191095213u, 210204763u, 231225257u, 254347801u,
+    279782593u, 307760897u, 338536987u, 372390691u, 409629809u, 450592801u, 495652109u, 545217341u,
+    599739083u, 659713007u, 725684317u, 798252779u, 878078057u, 965885863u, 1062474559u, 1168722059u,
+    1285594279u, 1414153729u, 1555569107u, 1711126033u, 1882238639u, 2070462533u, 2277508787u, 2505259681u,
+    2755785653u, 3031364227u, 3334500667u, 3667950739u, 4034745863u, 4294967291u
+};
+
+const unsigned N_GROWTH_PRIMES = sizeof GROWTH_PRIMES / sizeof GROWTH_PRIMES[0];
+
+
+//Return the smallest growth prime at least as large as n
+//(the largest one if n is larger)
+inline uint32_t growth_prime( uint32_t n )
+{
+    const uint32_t* last = GROWTH_PRIMES + N_GROWTH_PRIMES;
+    const uint32_t* p = lower_bound( GROWTH_PRIMES, last, n );
+
+    return (p == last) ? last[-1] : *p;
+}
+
+
+/* ********************************** *
+* Sizing policies                     *
+* *********************************** */
+
+//A sizing policy decides the number of slots of the table and
+//how a full-width hash value is reduced to a slot
+//  unsigned resize(unsigned n): return the table size to use for at least n slots
+//  unsigned slot(size_t hashVal) const: return a slot in [0, size)
+
+//Mix the bits of a hash value (finalizer of MurmurHash3)
+//so that weak hash functions do not cluster when only some bits are used
+inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+
+    return x;
+}
+
+//Prime table sizes (see GROWTH_PRIMES), the hash value is reduced with modulo
+//The modulo is computed without division, by Lemire's method: M = ceil(2^64 / size) is
+//computed once per size, then x % size = ((M * x mod 2^64) * size) >> 64 for all 32 bits x
+//The hash value is folded to 32 bits first, which does not change hash values below 2^32
+//The index of the current size is kept, so a resize steps from it instead of searching
+//GROWTH_PRIMES: doubling the size takes about 8 steps, whatever the size
+struct Prime_Sizing
+{
+    unsigned resize(unsigned n)
+    {
+        while (index + 1 < N_GROWTH_PRIMES && GROWTH_PRIMES[index] < n) ++index;
+        while (index > 0 && GROWTH_PRIMES[index - 1] >= n) --index;
+
+        size = GROWTH_PRIMES[index];
+        M = UINT64_MAX / size + 1;
+
+        return size;
+    }
+
+    unsigned slot(size_t hashVal) const
+    {
+        uint32_t x = (uint32_t) (hashVal ^ ((uint64_t) hashVal >> 32));
+
+        return (unsigned) (((__uint128_t) (M * x) * size) >> 64);
+    }
+
+    uint64_t size = 1;
+    uint64_t M = 0;
+    unsigned index = 0;
+};
+
+//Largest power of two table size, given to larger requests
+//(as Prime_Sizing gives the largest growth prime)
+const unsigned MAX_POW2_SIZE = 1u << 31;
+
+//Power of two table sizes, the mixed hash value is reduced with a mask
+struct Pow2_Sizing
+{
+    unsigned resize(unsigned n)
+    {
+        unsigned s = 1;
+        while (s < n && s < MAX_POW2_SIZE) s <<= 1;
+
+        mask = s - 1;
+        return s;
+    }
+
+    unsigned slot(size_t hashVal) const
+    {
+        return mix64(hashVal) & mask;
+    }
+
+    unsigned mask = 0;
+};
+
+//Power of two table sizes, reduced with Lemire's fastrange: (x * size) >> 32
+//The hash value is mixed with a multiplication by 2^64/phi (Fibonacci hashing)
+//whose high 32 bits are used as x
+struct Fastrange_Sizing
+{
+    unsigned resize(unsigned n)
+    {
+        size = 1;
+        while (size < n && size < MAX_POW2_SIZE) size <<= 1;
+
+        return size;
+    }
+
+    unsigned slot(size_t hashVal) const
+    {
+        uint64_t x = ((uint64_t) hashVal * 0x9e3779b97f4a7c15ull) >> 32;
+
+        return (x * size) >> 32;
+    }
+
+    uint64_t size = 1;
+};
+
+/* ********************************** *
+* Statistics                          *
+* *********************************** */
+
+//Statistics about the state of a table and the quality of its hash function
+//See HashTable::statistics()
+struct Table_Statistics
+{
+    unsigned size;               //number of slots
+    unsigned items;              //number of items
+    unsigned deleted;            //number of deleted slots
+    double load_factor;          //(items + deleted) / size
+    double tombstone_ratio;      //deleted / size
+
+    //probe_histogram[i] is the number of operations (search, insert, remove) that
+    //visited i+1 slots, the last entry also counts the longer probes
+    vector<unsigned> probe_histogram;
+    double mean_probe_length;
+
+    //distance from the home slot to the slot of each item
+    unsigned max_displacement;
+    double mean_displacement;
+
+    //cluster_histogram[k] is the number of clusters (runs of used or deleted slots)
+    //with length in [2^k, 2^(k+1))
+    vector<unsigned> cluster_histogram;
+    unsigned max_cluster;
+
+    unsigned rehash_count;
+    double rehash_seconds;       //total time spent re-hashing
+
+    unsigned purge_count = 0;    //purges of the deleted slots, see HashTable::purge_deleted()
+    double purge_seconds = 0;
+
+    //chi-square statistic of the number of items per home slot, divided by its
+    //degrees of freedom: about 1 for a uniform hash function, much larger if keys cluster
+    double chi_square;
+};
+
+
+//Display statistics s to stream os
+inline ostream& operator<<(ostream& os, const Table_Statistics& s)
+{
+    os << "Table size = " << s.size << ", items = " << s.items
+       << ", deleted = " << s.deleted << endl;
+    os << "Load factor = " << fixed << setprecision(2) << s.load_factor
+       << ", tombstone ratio = " << s.tombstone_ratio << endl;
+    os << "Mean probe length = " << s.mean_probe_length << endl;
+    os << "Probe lengths:";
+
+    for (unsigned i = 0; i < s.probe_histogram.size(); ++i)
+    {
+        if (s.probe_histogram[i])
+        {
+            bool last = (i + 1 == s.probe_histogram.size());
+            os << "  " << i + 1 << (last ? "+" : "") << ": " << s.probe_histogram[i];
+        }
+    }
+
+    os << endl;
+    os << "Displacement: max = " << s.max_displacement
+       << ", mean = " << s.mean_displacement << endl;
+    os << "Cluster lengths:";
+
+    for (unsigned k = 0; k < s.cluster_histogram.size(); ++k)
+    {
+        os << "  [" << (1u << k) << "," << (2u << k) << "): " << s.cluster_histogram[k];
+    }
+
+    os << endl;
+    os << "Longest cluster = " << s.max_cluster << endl;
+    os << "Re-hashes = " << s.rehash_count << " (" << setprecision(4) << s.rehash_seconds << " s)" << endl;
+
+    if (s.purge_count)
+    {
+        os << "Purges of deleted slots = " << s.purge_count << " (" << setprecision(4) << s.purge_seconds << " s)" << endl;
+    }
+    os << "Uniformity (chi-square / df, ideal 1) = " << setprecision(2) << s.chi_square << endl;
+
+    return os;
+}
+
+
 //Template class to represent an open addressing hash table using linear probing to resolve collisions
 //Internally the table is represented as an array of pointers to Items
-template <typename Key_Type, typename Value_Type>
+//Hash is a hash functor: size_t operator()(const Key_Type&) const
+//It returns a full-width hash value, the table reduces it to a slot
+//Size_Policy selects the table sizes and the reduction (see above)
+//Storage decides where the Items are allocated, see itemStorage.h
+//If Hash is transparent then lookups accept any key type K comparable to Key_Type,
+//and a Key_Type is only created when a new item is inserted
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Size_Policy = Prime_Sizing, typename Storage = Heap_Storage>
 class HashTable
 {
 public:
 
-    //New type HASH: pointer to a hash function
-    typedef unsigned (*HASH)(Key_Type, int);
-    
-    
     //Constructor to create a hash table
-    //table_size is number of slots in the table (next prime number is used)
-    //f is the hash function
-    HashTable(int table_size, HASH f);
+    //table_size is number of slots in the table (rounded up by the sizing policy)
+    //f is the hash functor
+    explicit HashTable(int table_size, const Hash& f = Hash());
 
 
     //Destructor
@@ -55,6 +378,18 @@ public:
         return nItems;
     }
 
+    //Return number of slots in the table
+    unsigned get_table_size() const
+    {
+        return _size;
+    }
+
+    //Return the hash functor
+    const Hash& hash_function() const
+    {
+        return h;
+    }
+
     //Return the total number of visited slots (during search, insert, remove, or re-hash)
     unsigned get_total_visited_slots() const
     {
@@ -68,59 +403,310 @@ public:
     }
 
     
+    //Key types accepted by _find, _insert, _remove, and operator[], see hashFunctions.h
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
     //Return a pointer to the value associated with key
     //If key does not exist in the table then nullptr is returned
-    const Value_Type* _find(const Key_Type& key);
+    const Value_Type* _find(const Key_Type& key)
+    {
+        return _find<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* _find(const K& key);
+
+
+    //Return a pointer to the value associated with key, or nullptr, as _find does
+    //The table is not modified (no item is moved to a deleted slot) and no statistics are updated,
+    //so several threads may call peek while no thread modifies the table
+    const Value_Type* peek(const Key_Type& key) const
+    {
+        return peek<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    const Value_Type* peek(const K& key) const;
 
 
     //Insert the Item (key, v) in the table
     //If key already exists in the table then change the value associated with key to v
     //Re-hash if the table reaches the MAX_LOAD_FACTOR
-    void _insert(const Key_Type& key, const Value_Type& v);
+    void _insert(const Key_Type& key, const Value_Type& v)
+    {
+        _insert<Key_Type>(key, v);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    void _insert(const K& key, const Value_Type& v);
 
 
     //Remove Item with key, if the item exists
     //If an Item was removed then return true
     //otherwise, return false
-    bool _remove(const Key_Type& key);
+    //Shrink the table if the items go below the MIN_LOAD_FACTOR,
+    //otherwise purge the deleted slots if they reach the MAX_DELETED_RATIO
+    bool _remove(const Key_Type& key)
+    {
+        return _remove<Key_Type>(key);
+    }
+
+    template <typename K, typename = Lookup_Key<K>>
+    bool _remove(const K& key);
+
+
+    //Insert the items (p.first, p.second) of the range [first, last) of pairs,
+    //as _insert does, with forward iterators
+    //The table is re-hashed at most once, before the first insertion (see reserve),
+    //and the keys are hashed and their home slots prefetched in batches
+    //Large ranges are inserted with several threads, see set_rehash_threads
+    template <typename Iterator>
+    void bulk_insert(Iterator first, Iterator last);
+
+
+    //Make room for n items: insert n - get_number_OF_items() new items without re-hashing
+    void reserve(unsigned n);
+
+
+    //Search the n keys in keys[0..n-1] and store in values[i] a pointer to the
+    //value associated with keys[i], or nullptr if keys[i] is not in the table
+    //The keys are processed in batches: all home slots of a batch are computed and
+    //prefetched first, so the cache misses of different keys overlap
+    template <typename K, typename = Lookup_Key<K>>
+    void find_many(const K* keys, size_t n, const Value_Type** values);
 
     //Overloaded subscript operator
     //If key is not in the table then insert a new Item = (key, Value_Type())
-    Value_Type& operator[](const Key_Type& key);
+    Value_Type& operator[](const Key_Type& key)
+    {
+        return operator[]<Key_Type>(key);
+    }
 
+    template <typename K, typename = Lookup_Key<K>>
+    Value_Type& operator[](const K& key);
 
-    //Display all items in table T to stream os
-    friend ostream& operator<<(ostream& os, const HashTable& T)
+
+    //Forward iterator over the items stored in the table, in slot order
+    //Empty and deleted slots are skipped
+    //Item_Type is Item<Key_Type, Value_Type> for iterator, so that the values can be modified,
+    //and const Item<Key_Type, Value_Type> for const_iterator
+    //An iterator is invalidated by any insertion or removal (the table may be re-hashed)
+    template <typename Item_Type>
+    class Slot_Iterator
     {
-        for (unsigned i = 0; i < T._size; ++i)
+    public:
+
+        typedef forward_iterator_tag iterator_category;
+        typedef Item_Type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef Item_Type* pointer;
+        typedef Item_Type& reference;
+
+        Slot_Iterator()
+            : slots(nullptr), deleted(nullptr), idx(0), size(0) { }
+
+        //Iterator to the first item in table[i..n-1], or to slot n if there is none
+        Slot_Iterator(Item<Key_Type, Value_Type>* const* table, unsigned i, unsigned n)
+            : slots(table), deleted(Deleted_Item<Key_Type, Value_Type>::get_Item()), idx(i), size(n)
+        {
+            skip();
+        }
+
+        //An iterator converts to a const_iterator
+        template <typename Other, typename = enable_if_t<is_same<const Other, Item_Type>::value>>
+        Slot_Iterator(const Slot_Iterator<Other>& it)
+            : slots(it.slots), deleted(it.deleted), idx(it.idx), size(it.size) { }
+
+        reference operator*() const
+        {
+            return *slots[idx];
+        }
+
+        pointer operator->() const
+        {
+            return slots[idx];
+        }
+
+        Slot_Iterator& operator++()
+        {
+            ++idx;
+            skip();
+
+            return *this;
+        }
+
+        Slot_Iterator operator++(int)
+        {
+            Slot_Iterator it = *this;
+            ++*this;
+
+            return it;
+        }
+
+        bool operator==(const Slot_Iterator& it) const
+        {
+            return idx == it.idx;
+        }
+
+        bool operator!=(const Slot_Iterator& it) const
+        {
+            return idx != it.idx;
+        }
+
+    private:
+
+        //Number of slots ahead of the current one whose Item is prefetched
+        static constexpr unsigned SCAN_AHEAD = 16;
+
+        Item<Key_Type, Value_Type>* const* slots;
+        const Item<Key_Type, Value_Type>* deleted;
+        unsigned idx;
+        unsigned size;
+
+        //Move to the first used slot from idx
+        //A slot is one pointer, so each slot is tested with one word compare;
+        //the slots are read sequentially (the hardware prefetches them), and the Items,
+        //which are anywhere in memory, are prefetched SCAN_AHEAD slots in advance
+        void skip()
         {
-            if (T.hTable[i] && T.hTable[i] != Deleted_Item<Key_Type,Value_Type>::get_Item())
+            while (idx < size && (!slots[idx] || slots[idx] == deleted)) ++idx;
+
+            if (idx + SCAN_AHEAD < size)
             {
-                os << *T.hTable[i] << endl;
+                __builtin_prefetch(slots[idx + SCAN_AHEAD]);
             }
         }
 
+        template <typename>
+        friend class Slot_Iterator;
+    };
+
+    typedef Slot_Iterator<Item<Key_Type, Value_Type>> iterator;
+    typedef Slot_Iterator<const Item<Key_Type, Value_Type>> const_iterator;
+
+    iterator begin()
+    {
+        return iterator(hTable, 0, _size);
+    }
+
+    iterator end()
+    {
+        return iterator(hTable, _size, _size);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(hTable, 0, _size);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(hTable, _size, _size);
+    }
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const HashTable& T)
+    {
+        for (const Item<Key_Type, Value_Type>& item : T)
+        {
+            os << item << endl;
+        }
+
         return os;
     }
 
 
+    //Call f(key, value) for each item stored in the table, in slot order
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (const Item<Key_Type, Value_Type>& item : *this)
+        {
+            f(item.get_key(), item.get_value());
+        }
+    }
+
+
+    //Return the k items with the largest values, the largest value first
+    //Items with equal values are ordered by key
+    //The table is scanned once and the best k items are kept in a heap,
+    //so it takes O(n log k) time and O(k) extra memory
+    vector<const Item<Key_Type, Value_Type>*> top_k(size_t k) const;
+
+
+    //Return all items sorted as in top_k, the largest value first
+    //Only pointers to the items are sorted, the keys and values are not copied
+    //The pointers are split in n_threads parts, sorted in parallel and then merged
+    vector<const Item<Key_Type, Value_Type>*> sorted_by_value(int n_threads = 1) const;
+
+
     //Display the table for debug and testing purposes
     //Thus, empty and deleted entries are also displayed
     void display(ostream& os);
+
+
+    //Return statistics about the table and the quality of the hash function
+    //The histograms are computed by scanning the table
+    Table_Statistics statistics() const;
     
     void disallowRehashing();
 
+    //Set the load factor above which the table is re-hashed, by default MAX_LOAD_FACTOR
+    //It is at most MAX_USABLE_LOAD_FACTOR, so that the table keeps empty slots
+    void set_max_load_factor(double lf)
+    {
+        maxLoadFactor = min(lf, MAX_USABLE_LOAD_FACTOR);
+    }
+
+
+    //Set the load factor below which the table shrinks after a deletion, by default MIN_LOAD_FACTOR
+    //0 disables shrinking. It should be well below maxLoadFactor/2
+    void set_min_load_factor(double lf)
+    {
+        minLoadFactor = lf;
+    }
+
+
+    //Set the number of threads used to re-hash and to bulk insert, by default 1
+    //With several threads the table is split in ranges of slots, one per thread,
+    //so the items may end up in other slots than with one thread
+    void set_rehash_threads(unsigned n)
+    {
+        rehashThreads = max(n, 1u);
+    }
+
+
+    //Shrink (or grow) the table to the smallest size that holds the items below maxLoadFactor
+    void shrink_to_fit()
+    {
+        rehash((unsigned) (nItems / maxLoadFactor) + 1);
+    }
+
+
+    //Remove all deleted slots, in place: the table size does not change
+    //The items of each cluster are placed again, so that no search needs a deleted slot
+    void purge_deleted();
+
 private:
 
     /* ********************************** *
     * Data members                        *
     * *********************************** */
 
-    //Number of slots in the table, a prime number
+    //Number of slots in the table, given by the sizing policy
     unsigned _size;
 
-    //Hash function
-    const HASH h;
+    //Hash functor
+    Hash h;
+
+    //Sizing policy, reduces hash values to slots
+    Size_Policy sizer;
+
+    //Storage policy, allocates the Items
+    Storage store;
 
     //Number of items stored in the table
     //Instances of Deleted_Items are not counted
@@ -137,28 +723,153 @@ private:
     unsigned total_visited_slots;  //total number of visited slots
     unsigned count_new_items;      //number of calls to new Item()
     bool rehashingAllowed = true;
+    double maxLoadFactor = MAX_LOAD_FACTOR;
+    double minLoadFactor = MIN_LOAD_FACTOR;
 
+    //The table does not shrink below the initial size
+    unsigned initialSize;
 
-    /* ********************************** *
-    * Auxiliar member functions           *
-    * *********************************** */
-    void rehash();
-    idxPair locateIdxs(const Key_Type& key);
+    //Threads used to re-hash and to bulk insert, for tables with at least PARALLEL_MIN_ITEMS items
+    unsigned rehashThreads = 1;
+    static constexpr unsigned PARALLEL_MIN_ITEMS = 1 << 14;
 
-    //Disable copy constructor!!
-    HashTable(const HashTable &) = delete;
+    //Number of slots visited by each operation, see Table_Statistics
+    static constexpr unsigned PROBE_BINS = 32;
+    unsigned probe_histogram[PROBE_BINS] = {};
+    unsigned long long probe_operations = 0;
+    unsigned long long probe_slots = 0;
 
-    //Disable assignment operator!!
-    const HashTable& operator=(const HashTable &) = delete;
+    unsigned rehash_count = 0;
+    double rehash_seconds = 0;
 
-};
+    unsigned purge_count = 0;
+    double purge_seconds = 0;
 
 
-//Test if a number is prime
-bool isPrime( int n );
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+    //Move the items to a new table with at least n_slots slots, deleted slots are dropped
+    void rehash(unsigned n_slots);
 
-//Return a prime number at least as large as n
-int nextPrime( int n );
+    //Return true if item a comes before item b in top_k and sorted_by_value,
+    //i.e. a has a larger value, or the same value and a smaller key
+    static bool by_value(const Item<Key_Type, Value_Type>* a, const Item<Key_Type, Value_Type>* b)
+    {
+        if (b->get_value() < a->get_value()) return true;
+        if (a->get_value() < b->get_value()) return false;
+
+        return a->get_key() < b->get_key();
+    }
+
+    //Called when the load factor is above maxLoadFactor
+    //If the items alone are below half of maxLoadFactor then the load is mostly deleted slots,
+    //and they are purged; otherwise the table grows
+    void make_room()
+    {
+        if (nItems <= maxLoadFactor / 2 * _size)
+        {
+            purge_deleted();
+        }
+        else
+        {
+            rehash(_size * 2);
+        }
+    }
+
+    //Insert the Item (key, v) in the slot given by idxs, the result of locateIdxs(key)
+    template <typename K>
+    void insert_at(idxPair idxs, const K& key, const Value_Type& v);
+
+    //Parallel re-hash and bulk insert
+    //The slots are split in rehashThreads ranges, and each entry is routed to the range of
+    //its home slot. Then each thread probes only inside its range: a thread never writes
+    //to the slots of another range. An entry whose probe reaches the end of its range
+    //(the probe would wrap into the next range) is spilled, and the spilled entries
+    //are handled by one thread at the end
+
+    //Place the items of oldTable in the (empty) table
+    void place_parallel(Item<Key_Type, Value_Type>** oldTable, unsigned oldsize);
+
+    //Insert the n pairs starting at first, as bulk_insert does
+    template <typename Iterator>
+    void bulk_insert_parallel(Iterator first, size_t n);
+
+    //Return the first slot of each range, and _size at the end
+    vector<unsigned> slot_ranges() const
+    {
+        vector<unsigned> bounds(rehashThreads + 1);
+
+        for (unsigned j = 0; j <= rehashThreads; ++j)
+        {
+            bounds[j] = (unsigned) ((unsigned long long) _size * j / rehashThreads);
+        }
+
+        return bounds;
+    }
+
+    //Return the range of slot idx
+    static unsigned range_of(unsigned idx, const vector<unsigned>& bounds)
+    {
+        return upper_bound(bounds.begin(), bounds.end(), idx) - bounds.begin() - 1;
+    }
+
+    //Call f(j) for j = 0..n-1, each call in its own thread
+    template <typename Function>
+    static void in_parallel(unsigned n, Function f)
+    {
+        vector<thread> workers;
+
+        for (unsigned j = 0; j < n; ++j)
+        {
+            workers.emplace_back(f, j);
+        }
+
+        for (thread& t : workers) t.join();
+    }
+
+    //Store item p in the first empty slot from its home slot
+    //The table must not have an item with the same key, nor deleted slots (e.g. when re-hashing)
+    void place(Item<Key_Type, Value_Type>* p);
+
+    //Create a new Item (key, v)
+    template <typename K>
+    Item<Key_Type, Value_Type>* new_item(const K& key, const Value_Type& v)
+    {
+        return store.template make_item<Key_Type, Value_Type>(make_key<Key_Type>(key), v);
+    }
+
+    template <typename K>
+    idxPair locateIdxs(const K& key)
+    {
+        return locateIdxs(key, home_slot(key));
+    }
+
+    //Probe for key starting at slot home, the home slot of key
+    template <typename K>
+    idxPair locateIdxs(const K& key, unsigned home);
+
+    //Number of keys in a batch of find_many
+    static constexpr unsigned BATCH_SIZE = 16;
+
+    //Return the home slot of key, i.e. the slot where probing starts
+    template <typename K>
+    unsigned home_slot(const K& key) const
+    {
+        return sizer.slot(h(key));
+    }
+
+    //Async_HashTable re-hashes a table in a background thread, see asyncHashTable.h
+    template <typename, typename, typename, typename>
+    friend class Async_HashTable;
+
+    //Disable copy constructor!!
+    HashTable(const HashTable &) = delete;
+
+    //Disable assignment operator!!
+    const HashTable& operator=(const HashTable &) = delete;
+
+};
 
 
 /* ********************************** *
@@ -166,14 +877,14 @@ int nextPrime( int n );
 * *********************************** */
 
 //Constructor to create a hash table
-//table_size number of slots in the table (next prime number is used)
-//f is the hash function
-template <typename Key_Type, typename Value_Type>
-HashTable<Key_Type, Value_Type>::HashTable(int table_size, HASH f)
+//table_size number of slots in the table (rounded up by the sizing policy)
+//f is the hash functor
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::HashTable(int table_size, const Hash& f)
     : h(f)
 {
     //IMPLEMENT
-    _size = nextPrime(table_size); 
+    _size = initialSize = sizer.resize(table_size);
     nDeleted = nItems = total_visited_slots = count_new_items = 0; 
     
     hTable = new Item<Key_Type, Value_Type>*[_size]{nullptr}; //allocate memory for the table, init with nullptr
@@ -181,11 +892,12 @@ HashTable<Key_Type, Value_Type>::HashTable(int table_size, HASH f)
 
 
 //Destructor
-template <typename Key_Type, typename Value_Type>
-HashTable<Key_Type, Value_Type>::~HashTable()
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::~HashTable()
 {
     //IMPLEMENT
-    for(int i = 0; i < _size; i++)
+    //some storage policies release all items at once, then the slots are not visited
+    for(unsigned i = 0; Storage::template needs_free<Key_Type, Value_Type> && i < _size; i++)
     {
         //cout << i << endl;
         if(hTable[i] == nullptr) 
@@ -198,7 +910,7 @@ HashTable<Key_Type, Value_Type>::~HashTable()
         }
         else 
         {
-            delete hTable[i]; //free only the allocate memory
+            store.free_item(hTable[i]); //free only the allocate memory
         }
     }
     delete[] hTable; //delete the dynamiclly allocated pointers asswell
@@ -207,12 +919,14 @@ HashTable<Key_Type, Value_Type>::~HashTable()
 
 //Return a pointer to the value associated with key
 //If key does not exist in the table then nullptr is returned
-template <typename Key_Type, typename Value_Type>
-const Value_Type* HashTable<Key_Type, Value_Type>::_find(const Key_Type& key)
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+const Value_Type* HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::_find(const K& key)
 {
     idxPair idxs = locateIdxs(key);
     
-    bool isMatch = !!hTable[idxs.matchOrEmptyIdx];
+    //NOT_FOUND: the table has no empty slot, and key is not in the table
+    bool isMatch = idxs.matchOrEmptyIdx != NOT_FOUND && hTable[idxs.matchOrEmptyIdx];
     
     if(isMatch) 
     {
@@ -223,7 +937,7 @@ const Value_Type* HashTable<Key_Type, Value_Type>::_find(const Key_Type& key)
         else 
         {
             hTable[idxs.firstDeletedIdx] = hTable[idxs.matchOrEmptyIdx];
-            hTable[idxs.matchOrEmptyIdx] = nullptr;
+            hTable[idxs.matchOrEmptyIdx] = Deleted_Item<Key_Type, Value_Type>::get_Item(); //keep the probe chain intact
             return &hTable[idxs.firstDeletedIdx]->get_value();     
         }
     }
@@ -234,37 +948,53 @@ const Value_Type* HashTable<Key_Type, Value_Type>::_find(const Key_Type& key)
 }
 
 
-//Insert the Item (key, v) in the table
-//If key already exists in the table then change the value associated with key to v
-//Re-hash if the table reaches the MAX_LOAD_FACTOR
-template <typename Key_Type, typename Value_Type>
-void HashTable<Key_Type, Value_Type>::_insert(const Key_Type& key, const Value_Type& v)
+//Return a pointer to the value associated with key, or nullptr
+//The table is not modified
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+const Value_Type* HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::peek(const K& key) const
 {
-    idxPair idxs = locateIdxs(key);
-    
-    bool slotIsEmpty = !hTable[idxs.matchOrEmptyIdx];
-    
-    if(slotIsEmpty) 
+    const Item<Key_Type, Value_Type>* deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+    unsigned idx = home_slot(key);
+
+    for (unsigned visited = 0; visited < _size; ++visited)
     {
-        if(idxs.firstDeletedIdx == NOT_FOUND)
+        const Item<Key_Type, Value_Type>* p = hTable[idx];
+
+        if (!p)
         {
-            hTable[idxs.matchOrEmptyIdx] = new Item<Key_Type, Value_Type>{key, v};
-        } 
-        else 
+            return nullptr;
+        }
+        else if (p != deleted && p->get_key() == key)
         {
-            hTable[idxs.firstDeletedIdx] = new Item<Key_Type, Value_Type>{key, v};
+            return &p->get_value();
         }
-        count_new_items++;
-        nItems++;
+
+        if (++idx == _size) idx = 0;
     }
-    else
+
+    return nullptr;
+}
+
+
+//Insert the Item (key, v) in the table
+//If key already exists in the table then change the value associated with key to v
+//Re-hash if the table reaches the MAX_LOAD_FACTOR
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::_insert(const K& key, const Value_Type& v)
+{
+    //a table without empty nor deleted slots grows, even if re-hashing is not allowed
+    if(nItems == _size)
     {
-        hTable[idxs.matchOrEmptyIdx]->set_value(v);   
+        rehash(_size * 2);
     }
+
+    insert_at(locateIdxs(key), key, v);
     
-    if(loadFactor() > MAX_LOAD_FACTOR && rehashingAllowed)
+    if(loadFactor() > maxLoadFactor && rehashingAllowed)
     {
-         rehash();
+         make_room();
     } 
 }
 
@@ -272,12 +1002,13 @@ void HashTable<Key_Type, Value_Type>::_insert(const Key_Type& key, const Value_T
 //Remove Item with key, if the item exists
 //If an Item was removed then return true
 //otherwise, return false
-template <typename Key_Type, typename Value_Type>
-bool HashTable<Key_Type, Value_Type>::_remove(const Key_Type& key)
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+bool HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::_remove(const K& key)
 {
     idxPair idxs = locateIdxs(key);
     
-    bool slotIsEmpty = !hTable[idxs.matchOrEmptyIdx];
+    bool slotIsEmpty = idxs.matchOrEmptyIdx == NOT_FOUND || !hTable[idxs.matchOrEmptyIdx];
     
     if(slotIsEmpty) 
     {
@@ -285,24 +1016,84 @@ bool HashTable<Key_Type, Value_Type>::_remove(const Key_Type& key)
     }
     else
     {
-        delete hTable[idxs.matchOrEmptyIdx];   
+        store.free_item(hTable[idxs.matchOrEmptyIdx]);
         nItems --;
         nDeleted ++;
         hTable[idxs.matchOrEmptyIdx] = Deleted_Item<Key_Type, Value_Type>::get_Item();
+
+        //few items left, e.g. after a burst of insertions
+        if(nItems < minLoadFactor * _size && _size > initialSize && rehashingAllowed)
+        {
+            rehash(max(initialSize, (unsigned) (2 * nItems / maxLoadFactor) + 1));
+        }
+        //many deletions, e.g. when keys are inserted and removed all the time
+        else if((double) nDeleted / _size > MAX_DELETED_RATIO && rehashingAllowed)
+        {
+            purge_deleted();
+        }
         return true;
     }
 }
-template <typename Key_Type, typename Value_Type>
-Value_Type& HashTable<Key_Type, Value_Type>::operator[](const Key_Type& key)
+//Search the n keys in keys[0..n-1]
+//values[i] is a pointer to the value associated with keys[i], or nullptr if there is none
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::find_many(const K* keys, size_t n, const Value_Type** values)
 {
-    if(loadFactor() > MAX_LOAD_FACTOR && rehashingAllowed)
+    unsigned home[BATCH_SIZE];
+
+    for (size_t first = 0; first < n; first += BATCH_SIZE)
     {
-        rehash();
+        size_t count = min<size_t>(BATCH_SIZE, n - first);
+
+        //1. hash the keys and prefetch their home slots
+        for (size_t i = 0; i < count; ++i)
+        {
+            home[i] = home_slot(keys[first + i]);
+            __builtin_prefetch(&hTable[home[i]]);
+        }
+
+        //2. prefetch the items in the home slots
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Item<Key_Type, Value_Type>* p = hTable[home[i]];
+
+            if (p) __builtin_prefetch(p);
+        }
+
+        //3. probe, the first slots and items should now be in the cache
+        for (size_t i = 0; i < count; ++i)
+        {
+            idxPair idxs = locateIdxs(keys[first + i], home[i]);
+
+            bool isMatch = idxs.matchOrEmptyIdx != NOT_FOUND && hTable[idxs.matchOrEmptyIdx];
+
+            values[first + i] = isMatch ? &hTable[idxs.matchOrEmptyIdx]->get_value() : nullptr;
+        }
+    }
+}
+
+
+//Overloaded subscript operator
+//If key is not in the table then insert a new Item = (key, Value_Type())
+//Only then is a Key_Type created from key
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K, typename>
+Value_Type& HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::operator[](const K& key)
+{
+    if(loadFactor() > maxLoadFactor && rehashingAllowed)
+    {
+        make_room();
+    }
+    //a table without empty nor deleted slots grows, even if re-hashing is not allowed
+    else if(nItems == _size)
+    {
+        rehash(_size * 2);
     }
     
     idxPair idxs = locateIdxs(key);
     
-    bool isMatch = !!hTable[idxs.matchOrEmptyIdx];
+    bool isMatch = idxs.matchOrEmptyIdx != NOT_FOUND && hTable[idxs.matchOrEmptyIdx];
     
     if(isMatch) 
     { 
@@ -313,7 +1104,7 @@ Value_Type& HashTable<Key_Type, Value_Type>::operator[](const Key_Type& key)
         else 
         {
             hTable[idxs.firstDeletedIdx] = hTable[idxs.matchOrEmptyIdx];
-            hTable[idxs.matchOrEmptyIdx] = nullptr;
+            hTable[idxs.matchOrEmptyIdx] = Deleted_Item<Key_Type, Value_Type>::get_Item(); //keep the probe chain intact
             return hTable[idxs.firstDeletedIdx]->get_value();     
         }
     }
@@ -323,12 +1114,13 @@ Value_Type& HashTable<Key_Type, Value_Type>::operator[](const Key_Type& key)
         nItems++;
         if(idxs.firstDeletedIdx == NOT_FOUND)
         {
-            hTable[idxs.matchOrEmptyIdx] = new Item<Key_Type, Value_Type>{key, Value_Type{}};
+            hTable[idxs.matchOrEmptyIdx] = new_item(key, Value_Type{});
             return hTable[idxs.matchOrEmptyIdx]->get_value();
         }
         else
         {
-            hTable[idxs.firstDeletedIdx] = new Item<Key_Type, Value_Type>{key, Value_Type{}};
+            nDeleted--;
+            hTable[idxs.firstDeletedIdx] = new_item(key, Value_Type{});
             return hTable[idxs.firstDeletedIdx]->get_value(); 
         }
     }
@@ -339,8 +1131,8 @@ Value_Type& HashTable<Key_Type, Value_Type>::operator[](const Key_Type& key)
 //Display the table for debug and testing purposes
 //This function is used for debugging and testing purposes
 //Thus, empty and deleted entries are also displayed
-template <typename Key_Type, typename Value_Type>
-void HashTable<Key_Type, Value_Type>::display(ostream& os)
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::display(ostream& os)
 {
     os << "-------------------------------\n";
     os << "Number of items in the table: " << get_number_OF_items() << endl;
@@ -362,118 +1154,649 @@ void HashTable<Key_Type, Value_Type>::display(ostream& os)
         else
         {
             os << *hTable[i]
-               << "  (" << h(hTable[i]->get_key(),_size) << ")" << endl;
+               << "  (" << home_slot(hTable[i]->get_key()) << ")" << endl;
         }
     }
 
     os << endl;
 }
-template <typename Key_Type, typename Value_Type>
-void HashTable<Key_Type, Value_Type>::disallowRehashing(){
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::disallowRehashing(){
     rehashingAllowed = false;
 }
 
+//Return statistics about the table and the quality of the hash function
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+Table_Statistics HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::statistics() const
+{
+    const Item<Key_Type, Value_Type>* deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+
+    Table_Statistics s;
+
+    s.size = _size;
+    s.items = nItems;
+    s.deleted = nDeleted;
+    s.load_factor = loadFactor();
+    s.tombstone_ratio = (double) nDeleted / _size;
+
+    s.probe_histogram.assign(probe_histogram, probe_histogram + PROBE_BINS);
+    s.mean_probe_length = probe_operations ? (double) probe_slots / probe_operations : 0;
+
+    s.rehash_count = rehash_count;
+    s.rehash_seconds = rehash_seconds;
+    s.purge_count = purge_count;
+    s.purge_seconds = purge_seconds;
+
+    //displacements, and number of items per home slot (in bins of about 5 expected items)
+    unsigned bins = max(1u, min(_size, nItems / 5));
+    vector<unsigned> observed(bins, 0);
+    unsigned long long total_displacement = 0;
+
+    s.max_displacement = 0;
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        if (hTable[i] && hTable[i] != deleted)
+        {
+            unsigned home = home_slot(hTable[i]->get_key());
+            unsigned d = (i + _size - home) % _size;
+
+            s.max_displacement = max(s.max_displacement, d);
+            total_displacement += d;
+            observed[(unsigned long long) home * bins / _size]++;
+        }
+    }
+
+    s.mean_displacement = nItems ? (double) total_displacement / nItems : 0;
+
+    double chi = 0;
+
+    for (unsigned b = 0; b < bins; ++b)
+    {
+        //expected number of items in bin b, bins may differ by one slot in size
+        unsigned first = (unsigned) (((unsigned long long) b * _size + bins - 1) / bins);
+        unsigned last = (unsigned) (((unsigned long long) (b + 1) * _size + bins - 1) / bins);
+        double expected = (double) nItems * (last - first) / _size;
+
+        if (expected > 0)
+            chi += (observed[b] - expected) * (observed[b] - expected) / expected;
+    }
+
+    s.chi_square = (bins > 1) ? chi / (bins - 1) : 0;
+
+    //clusters, the scan starts after an empty slot so that no cluster is split by the wrap-around
+    unsigned start = 0;
+
+    while (start < _size && hTable[start]) ++start;
+
+    s.max_cluster = 0;
+
+    if (start == _size)
+    {
+        s.max_cluster = _size; //no empty slot: one cluster
+    }
+
+    unsigned run = 0;
+
+    for (unsigned k = 1; start < _size && k <= _size; ++k)
+    {
+        unsigned i = (start + k) % _size;
+
+        if (hTable[i])
+        {
+            run++;
+            continue;
+        }
+
+        if (run > 0)
+        {
+            unsigned bin = 0;
+            while ((2u << bin) <= run) ++bin;
+
+            if (s.cluster_histogram.size() <= bin) s.cluster_histogram.resize(bin + 1, 0);
+
+            s.cluster_histogram[bin]++;
+            s.max_cluster = max(s.max_cluster, run);
+        }
+
+        run = 0;
+    }
+
+    return s;
+}
+
+
+//Return the k items with the largest values, the largest value first
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+vector<const Item<Key_Type, Value_Type>*> HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::top_k(size_t k) const
+{
+    const Item<Key_Type, Value_Type>* deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+
+    //min-heap w.r.t. the output order: heap.front() is the worst of the best k items
+    vector<const Item<Key_Type, Value_Type>*> heap;
+
+    heap.reserve(min<size_t>(k, nItems));
+
+    for (unsigned i = 0; i < _size && k > 0; ++i)
+    {
+        const Item<Key_Type, Value_Type>* p = hTable[i];
+
+        if (!p || p == deleted)
+        {
+            continue;
+        }
+
+        if (heap.size() < k)
+        {
+            heap.push_back(p);
+            push_heap(heap.begin(), heap.end(), by_value);
+        }
+        else if (by_value(p, heap.front()))
+        {
+            pop_heap(heap.begin(), heap.end(), by_value);
+            heap.back() = p;
+            push_heap(heap.begin(), heap.end(), by_value);
+        }
+    }
+
+    sort_heap(heap.begin(), heap.end(), by_value);
+
+    return heap;
+}
+
+
+//Return all items sorted by value, the largest value first
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+vector<const Item<Key_Type, Value_Type>*> HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::sorted_by_value(int n_threads) const
+{
+    const Item<Key_Type, Value_Type>* deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+
+    vector<const Item<Key_Type, Value_Type>*> items;
+
+    items.reserve(nItems);
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        if (hTable[i] && hTable[i] != deleted)
+        {
+            items.push_back(hTable[i]);
+        }
+    }
+
+    //bounds of the parts: part j is items[bounds[j]..bounds[j+1]-1]
+    size_t parts = max(1, n_threads);
+    vector<size_t> bounds(parts + 1);
+
+    for (size_t j = 0; j <= parts; ++j)
+    {
+        bounds[j] = items.size() * j / parts;
+    }
+
+    vector<thread> workers;
+
+    for (size_t j = 0; j < parts; ++j)
+    {
+        workers.emplace_back([&items, &bounds, j]()
+        {
+            sort(items.begin() + bounds[j], items.begin() + bounds[j + 1], by_value);
+        });
+    }
+
+    for (thread& t : workers) t.join();
+
+    //merge neighbour parts two by two, the merges of a round run in parallel
+    for (size_t width = 1; width < parts; width *= 2)
+    {
+        workers.clear();
+
+        for (size_t j = 0; j + width < parts; j += 2 * width)
+        {
+            size_t first = bounds[j], middle = bounds[j + width], last = bounds[min(j + 2 * width, parts)];
+
+            workers.emplace_back([&items, first, middle, last]()
+            {
+                inplace_merge(items.begin() + first, items.begin() + middle, items.begin() + last, by_value);
+            });
+        }
+
+        for (thread& t : workers) t.join();
+    }
+
+    return items;
+}
+
+
 /* ********************************** *
 * Auxiliar member functions           *
 * *********************************** */
 //Add any if needed
-template <typename Key_Type, typename Value_Type>
-void HashTable<Key_Type, Value_Type>::rehash()
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::rehash(unsigned n_slots)
 {
-    cout << "rehashing!\n";
+    auto start = chrono::steady_clock::now();
+
     //uppdate the members to fit the new table
-    int oldsize = _size;
-    nDeleted = nItems = count_new_items = 0; //borde statistik variablerna nollas?
+    unsigned oldsize = _size;
+    nDeleted = 0; //deleted slots are not copied
     Item<Key_Type, Value_Type>** oldTable = hTable; //a new pointer to the old table
 
-    _size = nextPrime(_size * 2); //allocate new table at 2x size
+    _size = sizer.resize(n_slots); //allocate new table, e.g. at 2x size
     hTable = new Item<Key_Type, Value_Type>*[_size] {nullptr}; //no safety here.. assumes that there allways will be a new allocation available
 
-    for (int i = 0; i < oldsize; ++i)
+    if (rehashThreads > 1 && nItems >= PARALLEL_MIN_ITEMS)
     {
-        if(oldTable[i] != nullptr && oldTable[i] != Deleted_Item<Key_Type, Value_Type>::get_Item())
+        place_parallel(oldTable, oldsize);
+    }
+    else
+    {
+        for (unsigned i = 0; i < oldsize; ++i)
         {
-            //insert values from old nodes and dealocate the objects pointed to
-            _insert(oldTable[i]->get_key(), oldTable[i]->get_value() ); //insert from old to the new table
-            delete oldTable[i];
+            if(oldTable[i] != nullptr && oldTable[i] != Deleted_Item<Key_Type, Value_Type>::get_Item())
+            {
+                //move the items to the new table, no Item is copied nor deallocated
+                place(oldTable[i]);
+            }
         }
     }
     //dealocate the pointers
     delete[] oldTable;
 
+    rehash_count++;
+    rehash_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
     //should not end up here
-    if(loadFactor() > MAX_LOAD_FACTOR && rehashingAllowed){
+    if(loadFactor() > maxLoadFactor && rehashingAllowed){
         cout << "OBS! Recursive rehash call!\n";
-        rehash();
+        rehash(_size * 2);
+    }
+}
+
+//Insert the items (p.first, p.second) of the range [first, last)
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename Iterator>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::bulk_insert(Iterator first, Iterator last)
+{
+    size_t n = distance(first, last);
+
+    //the table is sized once, for the worst case of no key already in the table
+    reserve(nItems + n);
+
+    if (rehashThreads > 1 && n >= PARALLEL_MIN_ITEMS && Storage::concurrent)
+    {
+        bulk_insert_parallel(first, n);
+        return;
+    }
+
+    unsigned home[BATCH_SIZE];
+
+    while (first != last)
+    {
+        Iterator batch = first;
+        size_t count = 0;
+
+        //1. hash the keys of the batch and prefetch their home slots
+        for (; count < BATCH_SIZE && first != last; ++count, ++first)
+        {
+            home[count] = home_slot(first->first);
+            __builtin_prefetch(&hTable[home[count]]);
+        }
+
+        //2. insert, the load factor stays below maxLoadFactor
+        for (size_t i = 0; i < count; ++i, ++batch)
+        {
+            insert_at(locateIdxs(batch->first, home[i]), batch->first, batch->second);
+        }
+    }
+}
+
+
+//Make room for n items without re-hashing
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::reserve(unsigned n)
+{
+    unsigned needed = (unsigned) (n / maxLoadFactor) + 1;
+
+    if (_size < needed)
+    {
+        rehash(needed);
+    }
+    else if (n + nDeleted > maxLoadFactor * _size)
+    {
+        purge_deleted();
+    }
+}
+
+
+//Remove all deleted slots, in place
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::purge_deleted()
+{
+    if (nDeleted == 0)
+    {
+        return;
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    //the items are placed again in probe order, starting after a slot that is empty
+    //before the deleted slots are cleared: that slot ends a cluster, so when an item is
+    //placed, all items before it in its cluster are already in their final slots
+    //(a cleared deleted slot does not end a cluster: an item after it may have its
+    //home slot before it, and would be placed before the items in between)
+    unsigned first = 0;
+
+    while (first < _size && hTable[first]) ++first;
+
+    //no empty slot, only items and deleted slots: the table is built again
+    if (first == _size)
+    {
+        rehash(_size);
+        return;
     }
+
+    for (unsigned i = 0; i < _size; ++i)
+    {
+        if (hTable[i] == Deleted_Item<Key_Type, Value_Type>::get_Item())
+        {
+            hTable[i] = nullptr;
+        }
+    }
+
+    nDeleted = 0;
+
+    for (unsigned k = 1; k < _size; ++k)
+    {
+        unsigned i = (first + k) % _size;
+
+        if (hTable[i])
+        {
+            Item<Key_Type, Value_Type>* p = hTable[i];
+
+            hTable[i] = nullptr;
+            place(p);
+        }
+    }
+
+    purge_count++;
+    purge_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 }
 
-template <typename Key_Type, typename Value_Type>
-idxPair HashTable<Key_Type, Value_Type>::locateIdxs(const Key_Type& key)
+
+//Place the items of oldTable in the (empty) table, with rehashThreads threads
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::place_parallel(Item<Key_Type, Value_Type>** oldTable, unsigned oldsize)
+{
+    typedef Item<Key_Type, Value_Type>* Item_Ptr;
+
+    const Item_Ptr deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+    const unsigned T = rehashThreads;
+    const vector<unsigned> bounds = slot_ranges();
+
+    //1. thread t routes the items in part t of the old table: routed[t][j] has
+    //   the items with home slot in range j, with their home slots
+    vector<vector<vector<pair<unsigned, Item_Ptr>>>> routed(T, vector<vector<pair<unsigned, Item_Ptr>>>(T));
+
+    in_parallel(T, [&](unsigned t)
+    {
+        unsigned last = (unsigned) ((unsigned long long) oldsize * (t + 1) / T);
+
+        for (unsigned i = (unsigned) ((unsigned long long) oldsize * t / T); i < last; ++i)
+        {
+            if (oldTable[i] && oldTable[i] != deleted)
+            {
+                unsigned home = home_slot(oldTable[i]->get_key());
+
+                routed[t][range_of(home, bounds)].push_back({home, oldTable[i]});
+            }
+        }
+    });
+
+    //2. thread j places the items of range j, in the order of the old table
+    vector<vector<Item_Ptr>> spilled(T);
+    vector<unsigned> visited(T, 0);
+
+    in_parallel(T, [&](unsigned j)
+    {
+        unsigned count = 0;
+
+        for (unsigned t = 0; t < T; ++t)
+        {
+            for (const auto& entry : routed[t][j])
+            {
+                unsigned idx = entry.first;
+
+                while (idx < bounds[j + 1] && (count++, hTable[idx])) ++idx;
+
+                if (idx < bounds[j + 1])
+                    hTable[idx] = entry.second;
+                else
+                    spilled[j].push_back(entry.second);
+            }
+        }
+
+        visited[j] = count;
+    });
+
+    //3. the spilled items continue their probes in the next ranges
+    for (unsigned j = 0; j < T; ++j)
+    {
+        total_visited_slots += visited[j];
+
+        for (Item_Ptr p : spilled[j])
+        {
+            place(p);
+        }
+    }
+}
+
+
+//Insert the n pairs starting at first, with rehashThreads threads
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename Iterator>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::bulk_insert_parallel(Iterator first, size_t n)
 {
-       int idx = h(key, _size);
+    const Item<Key_Type, Value_Type>* deleted = Deleted_Item<Key_Type, Value_Type>::get_Item();
+    const unsigned T = rehashThreads;
+    const vector<unsigned> bounds = slot_ranges();
+
+    //the input is split in T parts
+    vector<Iterator> parts(T + 1, first);
+
+    for (unsigned t = 1; t <= T; ++t)
+    {
+        parts[t] = next(parts[t - 1], n * t / T - n * (t - 1) / T);
+    }
+
+    //1. thread t routes the pairs of part t: routed[t][j] has the pairs
+    //   with home slot in range j, in input order
+    vector<vector<vector<pair<unsigned, Iterator>>>> routed(T, vector<vector<pair<unsigned, Iterator>>>(T));
+
+    in_parallel(T, [&](unsigned t)
+    {
+        for (Iterator it = parts[t]; it != parts[t + 1]; ++it)
+        {
+            unsigned home = home_slot(it->first);
+
+            routed[t][range_of(home, bounds)].push_back({home, it});
+        }
+    });
+
+    //2. thread j inserts the pairs of range j, in input order
+    //   a key equal to it->first can only be in range j, before the first empty slot
+    //   after its home slot; if there is none in range j then the pair is spilled
+    //   all pairs with the same key have the same home slot, so they go to the same thread,
+    //   and if one is spilled then the next ones are also spilled
+    vector<vector<Iterator>> spilled(T);
+    vector<unsigned> visited(T, 0), created(T, 0), reused(T, 0);
+    vector<vector<unsigned>> histogram(T, vector<unsigned>(PROBE_BINS, 0));
+
+    in_parallel(T, [&](unsigned j)
+    {
+        for (unsigned t = 0; t < T; ++t)
+        {
+            for (const auto& entry : routed[t][j])
+            {
+                const auto& key = entry.second->first;
+                unsigned idx = entry.first;
+                int firstDeletedIdx = NOT_FOUND;
+                unsigned probe = 0;
+
+                for (; idx < bounds[j + 1]; ++idx)
+                {
+                    probe++;
+
+                    if (hTable[idx] == deleted)
+                    {
+                        firstDeletedIdx = (firstDeletedIdx == NOT_FOUND) ? idx : firstDeletedIdx;
+                    }
+                    else if (!hTable[idx] || hTable[idx]->get_key() == key)
+                    {
+                        break;
+                    }
+                }
+
+                visited[j] += probe;
+                histogram[j][min(probe, PROBE_BINS) - 1]++;
+
+                if (idx == bounds[j + 1])
+                {
+                    spilled[j].push_back(entry.second);
+                }
+                else if (hTable[idx])
+                {
+                    hTable[idx]->set_value(entry.second->second);
+                }
+                else
+                {
+                    hTable[firstDeletedIdx == NOT_FOUND ? idx : firstDeletedIdx] = new_item(key, entry.second->second);
+                    created[j]++;
+                    reused[j] += (firstDeletedIdx != NOT_FOUND);
+                }
+            }
+        }
+    });
+
+    for (unsigned j = 0; j < T; ++j)
+    {
+        total_visited_slots += visited[j];
+        probe_slots += visited[j];
+        count_new_items += created[j];
+        nItems += created[j];
+        nDeleted -= reused[j];
+
+        for (unsigned b = 0; b < PROBE_BINS; ++b)
+        {
+            probe_operations += histogram[j][b];
+            probe_histogram[b] += histogram[j][b];
+        }
+    }
+
+    //3. the spilled pairs continue their probes in the next ranges
+    for (unsigned j = 0; j < T; ++j)
+    {
+        for (Iterator it : spilled[j])
+        {
+            insert_at(locateIdxs(it->first), it->first, it->second);
+        }
+    }
+}
+
+
+//Insert the Item (key, v) in the slot given by idxs, the result of locateIdxs(key)
+//If key already exists in the table then change the value associated with key to v
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::insert_at(idxPair idxs, const K& key, const Value_Type& v)
+{
+    bool slotIsEmpty = idxs.matchOrEmptyIdx == NOT_FOUND || !hTable[idxs.matchOrEmptyIdx];
+    
+    if(slotIsEmpty) 
+    {
+        if(idxs.firstDeletedIdx == NOT_FOUND)
+        {
+            hTable[idxs.matchOrEmptyIdx] = new_item(key, v);
+        } 
+        else 
+        {
+            nDeleted--;
+            hTable[idxs.firstDeletedIdx] = new_item(key, v);
+        }
+        count_new_items++;
+        nItems++;
+    }
+    else
+    {
+        hTable[idxs.matchOrEmptyIdx]->set_value(v);   
+    }
+}
+
+
+//Store item p in the first empty slot from its home slot
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+void HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::place(Item<Key_Type, Value_Type>* p)
+{
+    unsigned idx = home_slot(p->get_key());
+
+    while (total_visited_slots++, hTable[idx])
+    {
+        if (++idx == _size) idx = 0;
+    }
+
+    hTable[idx] = p;
+}
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+template <typename K>
+idxPair HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>::locateIdxs(const K& key, unsigned home)
+{
+       int idx = home;
        int startIdx = idx;
        int firstDeletedIdx = NOT_FOUND;
+       unsigned visited = 0;
        
        while(1)
        {
-           total_visited_slots++;
-           
-           if(!hTable[idx] || hTable[idx]->get_key() == key)
-           {
-               break;
-           }
+           visited++;
            
            if(hTable[idx] == Deleted_Item<Key_Type,Value_Type>::get_Item() )
            {
+               //the dummy item has key Key_Type(), it must never match
                firstDeletedIdx = (firstDeletedIdx == NOT_FOUND) ? idx : firstDeletedIdx;
            }
+           else if(!hTable[idx] || hTable[idx]->get_key() == key)
+           {
+               break;
+           }
            
            idx++;
            
-           if(idx == startIdx)
+           if(idx == (int) _size)
            {
-               idx = NOT_FOUND;
-               break;
+               idx = 0;
            }
            
-           if(idx == _size)
+           if(idx == startIdx)
            {
-               idx = 0;
+               idx = NOT_FOUND;
+               break;
            }
        }
+       
+       total_visited_slots += visited;
+       probe_slots += visited;
+       probe_operations++;
+       probe_histogram[min(visited, PROBE_BINS) - 1]++;
+       
        return {idx, firstDeletedIdx};
 }
 
 /* ********************************** *
-* Functions to find prime numbers     *
+* Tables with interned string keys    *
 * *********************************** */
 
+//Hash table with string keys, stored in an arena owned by the table (see Arena_Storage)
+//The hash functor should be transparent, so that string and string_view keys can be used
+template <typename Value_Type, typename Hash = std::hash<string_view>, typename Size_Policy = Prime_Sizing>
+using Interned_HashTable = HashTable<string_view, Value_Type, Hash, Size_Policy, Arena_Storage>;
 
-//Test if a number is prime
-bool isPrime( int n )
-{
-    if( n == 2 || n == 3 )
-        return true;
-
-    if( n == 1 || n % 2 == 0 )
-        return false;
-
-    for( int i = 3; i * i <= n; i += 2 )
-        if( n % i == 0 )
-            return false;
-
-    return true;
-}
-
-
-//Return a prime number at least as large as n
-int nextPrime( int n )
-{
-    if( n % 2 == 0 )
-        n++;
-
-    for(; !isPrime( n ); n += 2 );
-
-    return n;
-}
+#endif
@@ -0,0 +1,100 @@
+/*
+  Course: TND004, Lab 2
+  Description: storage policies, deciding where the Items of a HashTable are allocated
+*/
+
+#ifndef ITEM_STORAGE_H
+#define ITEM_STORAGE_H
+
+#include "Item.h"
+#include "arena.h"
+
+#include <string_view>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+
+//A storage policy creates and releases the Items of a table
+//  Item<K,V>* make_item<K,V>(key, v): create the Item (key, v)
+//  void free_item(Item<K,V>* p): release an Item created by make_item
+//  needs_free<K,V>: false if the table does not have to call free_item for each
+//                   Item when it is destroyed (the policy releases everything at once)
+//  concurrent: true if make_item can be called by several threads at once
+
+
+//Each Item is allocated with new and released with delete
+struct Heap_Storage
+{
+    template <typename K, typename V>
+    static constexpr bool needs_free = true;
+
+    static constexpr bool concurrent = true;
+
+    template <typename K, typename V, typename Key>
+    Item<K, V>* make_item(Key&& key, const V& v)
+    {
+        return new Item<K, V>(std::forward<Key>(key), v);
+    }
+
+    template <typename K, typename V>
+    void free_item(Item<K, V>* p)
+    {
+        delete p;
+    }
+};
+
+
+//The Items are allocated in an arena owned by the table
+//string_view keys are interned: the characters are copied to the arena,
+//so the key does not have to outlive the call that inserted it
+//Destroying the table frees a few large blocks, instead of one block per Item
+//Note: the memory of removed Items is only reused when the table is destroyed
+struct Arena_Storage
+{
+    template <typename K, typename V>
+    static constexpr bool needs_free = !is_trivially_destructible<Item<K, V>>::value;
+
+    static constexpr bool concurrent = false;
+
+    template <typename K, typename V, typename Key>
+    Item<K, V>* make_item(Key&& key, const V& v)
+    {
+        void* p = arena.allocate(sizeof(Item<K, V>), alignof(Item<K, V>));
+
+        return new (p) Item<K, V>(intern(K(std::forward<Key>(key))), v);
+    }
+
+    template <typename K, typename V>
+    void free_item(Item<K, V>* p)
+    {
+        p->~Item();
+    }
+
+    Arena arena;
+
+private:
+
+    //Copy the characters of a string_view key to the arena
+    string_view intern(string_view key)
+    {
+        char* bytes = static_cast<char*>(arena.allocate(key.size() + 1, 1));
+
+        memcpy(bytes, key.data(), key.size());
+        bytes[key.size()] = '\0';
+
+        return string_view(bytes, key.size());
+    }
+
+    //Other keys are stored as they are
+    template <typename K>
+    K&& intern(K&& key)
+    {
+        return std::forward<K>(key);
+    }
+};
+
+#endif
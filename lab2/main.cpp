@@ -11,8 +11,18 @@
 #include <algorithm>
 #include <fstream>
 #include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <utility>
 
 #include "hashTable.h"
+#include "concurrentHashTable.h"
+#include "shardedHashTable.h"
+#include "hashFunctions.h"
+#include "mappedFile.h"
+#include "tokenizer.h"
+#include "sketches.h"
 
 using namespace std;
 
@@ -20,19 +30,32 @@ const unsigned SEED = 1159241;
 
 const string PUNCT = ".,!?:\"();";
 
+const int TOP_WORDS = 10;
+
+const int HEAVY_HITTERS = 100;
+
+//Space-Saving monitors more keys than it reports, so that the reported counts are accurate
+const int MONITORED_KEYS = 10 * HEAVY_HITTERS;
+
+
+//Display the statistics of the table and write the frequency table to file_out, sorted by key
+template <typename Table>
+void report(const Table& freq_table, int _count, ostream& file_out);
+
+//Read the words in file_in with n_threads threads and call f(i, word)
+//for each normalized word, where i is the calling thread
+//Return the number of words read
+template <typename Function>
+int for_each_word_parallel(Mapped_File& file_in, int n_threads, Function f);
 
-//Hash function for English words
-//Polynomial accumulation
-//the Horner's rule is used to compute the value
-//See pag. 213 of course book
-unsigned _hash(string s, int tableSize);
 
 int main()
 {
     
 
-    string fileNr, temp, fileName;
+    string fileNr, temp, fileName, shards, approximate;
     int initialTableSize;
+    int n_threads = 1;
     
     cout << "Select test file nr: ";
     cin >> fileNr;
@@ -40,10 +63,22 @@ int main()
     cin >> initialTableSize;
     cout << "Allow rehasing? (y/n)";
     cin >> temp;
+    cout << "Number of threads (1 = sequential): ";
+    cin >> n_threads;
+    if (n_threads > 1)
+    {
+        cout << "Count in thread-local shards? (y/n)";
+        cin >> shards;
+    }
+    else
+    {
+        cout << "Approximate counting in fixed memory? (y/n)";
+        cin >> approximate;
+    }
     
-    HashTable<string,int> freq_table(initialTableSize, _hash);
-    if(temp == "n"){
-        freq_table.disallowRehashing();
+    //only the table of the selected mode is created, in its branch below
+    const bool rehashing = (temp != "n");
+    if(!rehashing){
         cout << "rehashing disabled" << endl;;
     } 
     else{
@@ -52,10 +87,10 @@ int main()
     }
     
     fileName = "test_file" + fileNr + ".txt";
-    ifstream file_in(fileName);
+    Mapped_File file_in(fileName);
     ofstream file_out("out_"+fileName);
 
-    if (!file_in || !file_out)
+    if (!file_in.is_open() || !file_out)
     {
         cout << "Could not open a file!!" << endl;
 
@@ -64,29 +99,129 @@ int main()
     
     
     cout << "Reading file: '" << fileName << "'..." << endl << endl;
-        
-    string s;
-    int _count = 0;
     
-    //Read words and load them in the hash table
-    while (file_in >> s)
+    if (n_threads > 1 && shards == "y")
     {
-        //transform all upper-case letters to lower-case letters
-        transform(s.begin(), s.end(), s.begin(), ::tolower);
+        ShardedHashTable<string,int,Horner_Hash> sharded_table(initialTableSize, n_threads);
+        if (!rehashing) sharded_table.disallowRehashing();
+
+        //each thread counts in its own shard, the shards are merged at the end
+        int _count = for_each_word_parallel(file_in, n_threads, [&](int i, string_view s)
+        {
+            sharded_table.shard(i)[s]++;
+        });
+
+        sharded_table.merge(n_threads);
 
-        string s1;
+        report(sharded_table, _count, file_out);
+    }
+    else if (n_threads > 1)
+    {
+        ConcurrentHashTable<string,int,Horner_Hash> concurrent_table(initialTableSize);
+        if (!rehashing) concurrent_table.disallowRehashing();
 
-        copy_if(s.begin(), s.end(), back_inserter(s1), [](char c)
+        int _count = for_each_word_parallel(file_in, n_threads, [&](int, string_view s)
         {
-            return (PUNCT.find(c) == string::npos);
+            concurrent_table.increment(s);
         });
-        // cout << "HÄR!" << endl;
-        //if s is not in the table then it is inserted
-        freq_table[s1]++;
 
-        _count++;
+        report(concurrent_table, _count, file_out);
     }
-    
+    else if (approximate == "y")
+    {
+        //frequencies, number of unique words, and most frequent words are estimated
+        //the rows of Count-Min need independent hash functions, thus a seeded hash
+        Count_Min<string, Wy_Hash> frequencies;
+        HyperLogLog<string, Horner_Hash> unique_words;
+        Space_Saving<string, Horner_Hash> heavy_hitters(MONITORED_KEYS);
+
+        Word_Tokenizer words(file_in.data(), file_in.data() + file_in.size(), PUNCT);
+        string_view s;
+        int _count = 0;
+
+        while (words.next(s))
+        {
+            frequencies.increment(s);
+            unique_words.add(s);
+            heavy_hitters.increment(s);
+
+            _count++;
+        }
+
+        cout << "\nNumber of words in the file = " << _count << endl;
+
+        cout << "Estimated number unique  words in the file = "
+             << fixed << setprecision(0) << unique_words.estimate() << endl;
+
+        cout << "Memory used by the sketches = "
+             << frequencies.memory_usage() + unique_words.memory_usage() + heavy_hitters.memory_usage()
+             << " bytes" << endl;
+
+        cout << "\nMost frequent words ..." << endl;
+
+        file_out << "Estimated frequency of the most frequent words ..." << endl << endl;
+
+        int rank = 0;
+
+        for (const auto& c : heavy_hitters.top(HEAVY_HITTERS))
+        {
+            //Count-Min and Space-Saving both overestimate, the smallest estimate is kept
+            unsigned long long count = min<unsigned long long>(c.count, frequencies.estimate(c.key));
+
+            file_out << "key = " << "\"" << c.key << "\""
+                     << setw(12) << "value = " << count << endl;
+
+            if (rank++ < TOP_WORDS)
+            {
+                cout << "key = " << "\"" << c.key << "\""
+                     << setw(12) << "value = " << count << endl;
+            }
+        }
+    }
+    else
+    {
+        HashTable<string,int,Horner_Hash> freq_table(initialTableSize);
+        if (!rehashing) freq_table.disallowRehashing();
+
+        //the words are normalized in place, in the mapped file
+        Word_Tokenizer words(file_in.data(), file_in.data() + file_in.size(), PUNCT);
+        string_view s;
+        int _count = 0;
+
+        //Read words and load them in the hash table
+        while (words.next(s))
+        {
+            //if s is not in the table then it is inserted
+            //a string is only created for new words
+            freq_table[s]++;
+
+            _count++;
+        }
+
+        report(freq_table, _count, file_out);
+
+        cout << "\nHash table statistics ..." << endl;
+        cout << freq_table.statistics();
+
+        cout << "\nMost frequent words ..." << endl;
+
+        for (auto p : freq_table.top_k(TOP_WORDS))
+        {
+            cout << *p << endl;
+        }
+    }
+
+    //close the file stream, the mapped file is closed by its destructor
+    file_out.close();
+
+    return 0;
+}
+
+
+//Display the statistics of the table and write the frequency table to file_out, sorted by key
+template <typename Table>
+void report(const Table& freq_table, int _count, ostream& file_out)
+{
     unsigned total = freq_table.get_total_visited_slots();
 
     cout << "\nNumber of words in the file = " << _count << endl;
@@ -109,28 +244,79 @@ int main()
 
     file_out << "Frequency table ..." << endl << endl;
 
-    file_out << freq_table << endl;
+    //the items are written sorted by key, not in the order of the table, so that
+    //the file is the same for all modes, table sizes, and numbers of threads
+    vector<pair<const string*, int>> items;
 
-    //close the file streams
-    file_in.close();
-    file_out.close();
+    freq_table.for_each([&items](const string& key, int value)
+    {
+        items.push_back({&key, value});
+    });
 
-    return 0;
+    sort(items.begin(), items.end(), [](const pair<const string*, int>& a, const pair<const string*, int>& b)
+    {
+        return *a.first < *b.first;
+    });
+
+    for (const auto& item : items)
+    {
+        file_out << "key = " << "\"" << *item.first << "\""
+                 << setw(12) << "value = " << item.second << endl;
+    }
+
+    file_out << endl;
 }
 
 
-//Hash function for English words
-//Polynomial accumulation
-//the Horner's rule is used to compute the value
-//See pag. 213 of course book
-unsigned _hash(string s, int tableSize)
+//Read the words in file_in with n_threads threads and call f(i, word)
+//for each normalized word, where i is the calling thread
+//Return the number of words read
+//The mapped file is split in n_threads chunks, at white spaces,
+//then each thread reads the words of one chunk
+template <typename Function>
+int for_each_word_parallel(Mapped_File& file_in, int n_threads, Function f)
 {
-    unsigned hashVal = 0;
+    char* text = file_in.data();
+    const size_t length = file_in.size();
+
+    vector<size_t> bounds(n_threads + 1, length);
+    bounds[0] = 0;
+
+    for (int i = 1; i < n_threads; ++i)
+    {
+        size_t pos = max(bounds[i - 1], length / n_threads * i);
+
+        while (pos < length && !isspace((unsigned char) text[pos])) ++pos;
 
-    for(unsigned i = 0; i < s.length(); i++)
-        hashVal = 37 * hashVal + s[i];
+        bounds[i] = pos;
+    }
 
-    hashVal %= tableSize;
+    vector<int> counts(n_threads, 0);
+    vector<thread> workers;
+
+    for (int i = 0; i < n_threads; ++i)
+    {
+        workers.emplace_back([&, i]()
+        {
+            //the chunks are disjoint, so each thread normalizes its words in place
+            Word_Tokenizer words(text + bounds[i], text + bounds[i + 1], PUNCT);
+            string_view s;
+
+            while (words.next(s))
+            {
+                f(i, s);
+                counts[i]++;
+            }
+        });
+    }
+
+    int _count = 0;
+
+    for (int i = 0; i < n_threads; ++i)
+    {
+        workers[i].join();
+        _count += counts[i];
+    }
 
-    return hashVal;
+    return _count;
 }
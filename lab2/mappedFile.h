@@ -0,0 +1,114 @@
+/*
+  Course: TND004, Lab 2
+  Description: class Mapped_File maps a file in memory (POSIX mmap)
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+//Class to represent a file mapped in memory
+//The file is not read into a buffer: the pages are loaded by the OS when accessed
+class Mapped_File
+{
+public:
+
+    //Map the file name in memory
+    //If writable then the pages are private (copy on write): the buffer can be
+    //modified in place without changing the file
+    explicit Mapped_File(const string& name, bool writable = true)
+        : buffer(nullptr), length(0)
+    {
+        int fd = open(name.c_str(), O_RDONLY);
+
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct stat st;
+
+        if (fstat(fd, &st) == 0)
+        {
+            length = st.st_size;
+            opened = true;
+        }
+
+        if (opened && length > 0)
+        {
+            int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            void* p = mmap(nullptr, length, prot, MAP_PRIVATE, fd, 0);
+
+            if (p == MAP_FAILED)
+            {
+                opened = false;
+                length = 0;
+            }
+            else
+            {
+                buffer = static_cast<char*>(p);
+                madvise(p, length, MADV_SEQUENTIAL);
+            }
+        }
+
+        close(fd); //the mapping stays valid
+    }
+
+
+    //Destructor
+    ~Mapped_File()
+    {
+        if (buffer)
+        {
+            munmap(buffer, length);
+        }
+    }
+
+
+    //Return true if the file could be mapped
+    bool is_open() const
+    {
+        return opened;
+    }
+
+    //Return the first character of the file
+    char* data()
+    {
+        return buffer;
+    }
+
+    const char* data() const
+    {
+        return buffer;
+    }
+
+    //Return the number of characters in the file
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+
+    char* buffer;
+    size_t length;
+    bool opened = false;
+
+    //Disable copy constructor!!
+    Mapped_File(const Mapped_File &) = delete;
+
+    //Disable assignment operator!!
+    const Mapped_File& operator=(const Mapped_File &) = delete;
+};
+
+#endif
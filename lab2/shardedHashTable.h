@@ -0,0 +1,311 @@
+/*
+  Course: TND004, Lab 2
+  Description: template class ShardedHashTable, counting in thread-local shards
+              that are merged in one table at the end
+*/
+
+#ifndef SHARDED_HASH_TABLE_H
+#define SHARDED_HASH_TABLE_H
+
+#include "hashTable.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+
+//Template class to represent a hash table filled by several threads without locks
+//Each worker thread i fills its own shard, shard(i), a HashTable<Key_Type, Value_Type>
+//When all workers are done, merge() adds the shards together: the keys are split in
+//partitions by hash value and each merge thread builds the table of one partition
+//Thus, hot keys (e.g. "the") are never contended by the workers
+template <typename Key_Type, typename Value_Type, typename Hash = std::hash<Key_Type>,
+          typename Size_Policy = Prime_Sizing>
+class ShardedHashTable
+{
+public:
+
+    typedef HashTable<Key_Type, Value_Type, Hash, Size_Policy> Table;
+
+    //Constructor to create n_shards empty shards
+    //table_size is the initial number of slots of each shard
+    //f is the hash functor
+    ShardedHashTable(int table_size, unsigned n_shards, const Hash& f = Hash());
+
+
+    //Destructor
+    ~ShardedHashTable();
+
+
+    //Return the shard of worker i
+    //Only worker i may access its shard until merge() is called
+    Table& shard(unsigned i)
+    {
+        return *shards[i];
+    }
+
+
+    //Merge the shards using n_threads threads, the values of a key are added with +=
+    //The shards are released
+    //Merging again splits the merged table in n_threads new partitions
+    void merge(unsigned n_threads = 1);
+
+
+    //Return the load factor of the merged table
+    double loadFactor() const;
+
+    //Return number of items stored in the merged table
+    unsigned get_number_OF_items() const;
+
+    //Return the total number of visited slots, in the shards and during the merge
+    unsigned get_total_visited_slots() const;
+
+    //Return the total number of call to new Item(), in the shards and during the merge
+    unsigned get_count_new_items() const;
+
+
+    //Call f(key, value) for each item of the merged table
+    //The partitions are visited one after the other, so the items are not
+    //in the same order as in a HashTable with the same items
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (const Table* part : parts)
+        {
+            part->for_each(f);
+        }
+    }
+
+
+    //Display all items of the merged table T to stream os, in the order of for_each
+    friend ostream& operator<<(ostream& os, const ShardedHashTable& T)
+    {
+        for (const Table* part : T.parts)
+        {
+            os << *part;
+        }
+
+        return os;
+    }
+
+
+    void disallowRehashing();
+
+private:
+
+    /* ********************************** *
+    * Data members                        *
+    * *********************************** */
+
+    //Hash functor, used to select the partition of a key
+    Hash h;
+
+    //Initial number of slots of a shard
+    int shardSize;
+
+    //Thread-local tables, released by merge()
+    vector<Table*> shards;
+
+    //Merged table, one HashTable per partition of the keys
+    vector<Table*> parts;
+
+    //Statistics of the released shards
+    unsigned shard_visited_slots;
+    unsigned shard_new_items;
+
+    bool rehashingAllowed = true;
+
+
+    /* ********************************** *
+    * Auxiliar member functions           *
+    * *********************************** */
+
+    //Return the partition of key, for n partitions
+    unsigned partition_of(const Key_Type& key, unsigned n) const
+    {
+        return (mix64(h(key)) >> 32) % n;
+    }
+
+    //An item of a shard, routed to a partition during a merge
+    typedef pair<const Key_Type*, const Value_Type*> Entry;
+
+    //Disable copy constructor!!
+    ShardedHashTable(const ShardedHashTable &) = delete;
+
+    //Disable assignment operator!!
+    const ShardedHashTable& operator=(const ShardedHashTable &) = delete;
+};
+
+
+/* ********************************** *
+* Member functions implementation     *
+* *********************************** */
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::ShardedHashTable(int table_size, unsigned n_shards, const Hash& f)
+    : h(f), shardSize(table_size), shards(n_shards, nullptr)
+{
+    shard_visited_slots = shard_new_items = 0;
+
+    for (unsigned i = 0; i < n_shards; ++i)
+    {
+        shards[i] = new Table(table_size, f);
+    }
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::~ShardedHashTable()
+{
+    for (Table* t : shards) delete t;
+    for (Table* t : parts) delete t;
+}
+
+
+//Merge the shards using n_threads threads, in two steps:
+//1. thread t scans the shards t, t + n_threads, ... and routes each item to its partition
+//2. thread p builds partition p from the items routed to p
+//The shards are only read during the merge, so no locks are needed
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::merge(unsigned n_threads)
+{
+    if (n_threads == 0) n_threads = 1;
+
+    //a merged table is merged again as a shard
+    shards.insert(shards.end(), parts.begin(), parts.end());
+    parts.clear();
+
+    //size each partition for its share of the largest shard, to avoid most re-hashing
+    unsigned largest = 0;
+
+    for (Table* t : shards)
+    {
+        largest = max(largest, t->get_number_OF_items());
+    }
+
+    int part_size = max(shardSize, (int) (largest / n_threads / MAX_LOAD_FACTOR) + 1);
+
+    parts.assign(n_threads, nullptr);
+
+    for (unsigned p = 0; p < n_threads; ++p)
+    {
+        parts[p] = new Table(part_size, h);
+
+        if (!rehashingAllowed) parts[p]->disallowRehashing();
+    }
+
+    //routed[t][p] has the items scanned by thread t that belong to partition p
+    vector<vector<vector<Entry>>> routed(n_threads, vector<vector<Entry>>(n_threads));
+
+    auto in_parallel = [n_threads](auto f)
+    {
+        vector<thread> workers;
+
+        for (unsigned t = 1; t < n_threads; ++t)
+        {
+            workers.emplace_back(f, t);
+        }
+
+        f(0);
+
+        for (thread& w : workers) w.join();
+    };
+
+    in_parallel([&](unsigned t)
+    {
+        for (size_t i = t; i < shards.size(); i += n_threads)
+        {
+            shards[i]->for_each([&](const Key_Type& key, const Value_Type& v)
+            {
+                routed[t][partition_of(key, n_threads)].push_back({&key, &v});
+            });
+        }
+    });
+
+    in_parallel([&](unsigned p)
+    {
+        Table& part = *parts[p];
+
+        for (unsigned t = 0; t < n_threads; ++t)
+        {
+            for (const Entry& e : routed[t][p])
+            {
+                part[*e.first] += *e.second;
+            }
+        }
+    });
+
+    //release the shards, but keep their statistics
+    for (Table* t : shards)
+    {
+        shard_visited_slots += t->get_total_visited_slots();
+        shard_new_items += t->get_count_new_items();
+        delete t;
+    }
+
+    shards.clear();
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+double ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::loadFactor() const
+{
+    double used = 0, slots = 0;
+
+    for (const Table* t : parts)
+    {
+        used += t->loadFactor() * t->get_table_size();
+        slots += t->get_table_size();
+    }
+
+    return (slots > 0) ? used / slots : 0;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_number_OF_items() const
+{
+    unsigned n = 0;
+
+    for (const Table* t : parts) n += t->get_number_OF_items();
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_total_visited_slots() const
+{
+    unsigned n = shard_visited_slots;
+
+    for (const Table* t : shards) n += t->get_total_visited_slots();
+    for (const Table* t : parts) n += t->get_total_visited_slots();
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+unsigned ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::get_count_new_items() const
+{
+    unsigned n = shard_new_items;
+
+    for (const Table* t : shards) n += t->get_count_new_items();
+    for (const Table* t : parts) n += t->get_count_new_items();
+
+    return n;
+}
+
+
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy>
+void ShardedHashTable<Key_Type, Value_Type, Hash, Size_Policy>::disallowRehashing()
+{
+    rehashingAllowed = false;
+
+    for (Table* t : shards) t->disallowRehashing();
+}
+
+#endif
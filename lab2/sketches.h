@@ -0,0 +1,366 @@
+/*
+  Course: TND004, Lab 2
+  Description: sketches to count the words of a stream approximately, in a fixed amount of memory
+              Count_Min estimates frequencies, HyperLogLog the number of unique keys,
+              and Space_Saving keeps the most frequent keys (heavy hitters)
+*/
+
+#ifndef SKETCHES_H
+#define SKETCHES_H
+
+#include "hashTable.h"
+#include "hashFunctions.h"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+
+/* ********************************** *
+* Class Count_Min                     *
+* *********************************** */
+
+//Template class to represent a Count-Min sketch: depth rows of width counters
+//A key increments one counter in each row, and its frequency is estimated by the smallest
+//of these counters. The estimate is never too small, and too large by at most
+//e/width * (total count) with probability 1 - exp(-depth)
+//The bound needs independent rows: row r hashes the keys with its own functor Hash(seed_r),
+//so two keys that collide in one row are not more likely to collide in the others
+//Thus, Hash must be constructible from a 64 bits seed, e.g. Wy_Hash
+template <typename Key_Type, typename Hash = Wy_Hash>
+class Count_Min
+{
+public:
+
+    //Key types accepted by increment and estimate, see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to create a sketch with n_rows rows of n_columns counters
+    //The seeds of the rows are derived from seed
+    explicit Count_Min(unsigned n_columns = 1 << 16, unsigned n_rows = 4, uint64_t seed = 0)
+        : width(max(n_columns, 1u)), depth(max(n_rows, 1u)), counters(width * depth, 0), total(0)
+    {
+        for (unsigned r = 0; r < depth; ++r)
+        {
+            h.push_back(Hash(mix64(seed + (r + 1) * 0x9e3779b97f4a7c15ull)));
+        }
+    }
+
+
+    //Add delta to the frequency of key
+    template <typename K, typename = Lookup_Key<K>>
+    void increment(const K& key, uint32_t delta = 1)
+    {
+        for (unsigned r = 0; r < depth; ++r)
+        {
+            counters[r * width + slot(key, r)] += delta;
+        }
+
+        total += delta;
+    }
+
+
+    //Return the estimated frequency of key
+    template <typename K, typename = Lookup_Key<K>>
+    uint32_t estimate(const K& key) const
+    {
+        uint32_t e = counters[slot(key, 0)];
+
+        for (unsigned r = 1; r < depth; ++r)
+        {
+            e = min(e, counters[r * width + slot(key, r)]);
+        }
+
+        return e;
+    }
+
+
+    //Return the sum of all increments
+    unsigned long long get_total() const
+    {
+        return total;
+    }
+
+    //Return the number of bytes used by the counters
+    size_t memory_usage() const
+    {
+        return counters.size() * sizeof(uint32_t);
+    }
+
+private:
+
+    unsigned width;
+    unsigned depth;
+    vector<Hash> h;             //h[r] is the hash functor of row r
+    vector<uint32_t> counters;  //row r is counters[r*width..(r+1)*width-1]
+    unsigned long long total;
+
+    //Return the slot of key in row r
+    template <typename K>
+    unsigned slot(const K& key, unsigned r) const
+    {
+        uint64_t x = mix64(h[r](key));
+
+        return (unsigned) (((__uint128_t) x * width) >> 64);
+    }
+};
+
+
+/* ********************************** *
+* Class HyperLogLog                   *
+* *********************************** */
+
+//Template class to estimate the number of unique keys added, with 2^precision registers of one byte
+//The relative error is about 1.04 / sqrt(2^precision), e.g. 0.8% with the default precision
+template <typename Key_Type, typename Hash = std::hash<Key_Type>>
+class HyperLogLog
+{
+public:
+
+    //Key types accepted by add, see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to create an estimator with 2^precision registers, 4 <= precision <= 18
+    explicit HyperLogLog(unsigned precision = 14, const Hash& f = Hash())
+        : p(min(max(precision, 4u), 18u)), h(f), registers(size_t(1) << p, 0)
+    { }
+
+
+    //Add key to the set of keys
+    template <typename K, typename = Lookup_Key<K>>
+    void add(const K& key)
+    {
+        uint64_t x = mix64(h(key));
+
+        //the first p bits select a register, the register keeps the longest run of
+        //leading zeros (plus one) seen in the remaining bits
+        size_t idx = x >> (64 - p);
+        uint64_t rest = (x << p) | (uint64_t(1) << (p - 1));
+        uint8_t rank = __builtin_clzll(rest) + 1;
+
+        registers[idx] = max(registers[idx], rank);
+    }
+
+
+    //Return the estimated number of unique keys added
+    double estimate() const
+    {
+        const double m = registers.size();
+        double sum = 0;
+        unsigned zeros = 0;
+
+        for (uint8_t r : registers)
+        {
+            sum += ldexp(1.0, -r);
+            zeros += (r == 0);
+        }
+
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double e = alpha * m * m / sum;
+
+        //few keys: most registers are still empty, use linear counting
+        if (e <= 2.5 * m && zeros > 0)
+        {
+            e = m * log(m / zeros);
+        }
+
+        return e;
+    }
+
+
+    //Return the number of bytes used by the registers
+    size_t memory_usage() const
+    {
+        return registers.size();
+    }
+
+private:
+
+    unsigned p;
+    Hash h;
+    vector<uint8_t> registers;
+};
+
+
+/* ********************************** *
+* Class Space_Saving                  *
+* *********************************** */
+
+//Template class to find the most frequent keys of a stream (heavy hitters), monitoring capacity keys
+//A new key replaces the monitored key with the smallest count c, and starts with count c + 1
+//and error c. Thus, a count is too large by at most its error, and every key with a frequency
+//larger than (total count) / capacity is monitored
+//The monitored keys are found with a HashTable, and kept in a min-heap by count
+template <typename Key_Type, typename Hash = std::hash<Key_Type>>
+class Space_Saving
+{
+public:
+
+    //A monitored key with its count, and the largest possible overestimation of the count
+    struct Counter
+    {
+        Key_Type key;
+        unsigned long long count;
+        unsigned long long error;
+    };
+
+
+    //Key types accepted by increment, see HashTable
+    template <typename K>
+    using Lookup_Key = Lookup_Key_For<K, Key_Type, Hash>;
+
+
+    //Constructor to monitor at most n_keys keys
+    //To report the top k keys accurately, n_keys should be several times k
+    explicit Space_Saving(unsigned n_keys = 1000, const Hash& f = Hash())
+        : capacity(max(n_keys, 1u)), index(2 * capacity, f)
+    {
+        counters.reserve(capacity);
+        heap.reserve(capacity);
+        position.reserve(capacity);
+    }
+
+
+    //Count one occurrence of key
+    template <typename K, typename = Lookup_Key<K>>
+    void increment(const K& key)
+    {
+        const unsigned* i = index._find(key);
+
+        if (i)
+        {
+            counters[*i].count++;
+            sift_down(position[*i]);
+
+            return;
+        }
+
+        if (counters.size() < capacity)
+        {
+            unsigned c = counters.size();
+
+            counters.push_back(Counter{make_key<Key_Type>(key), 1, 0});
+            index._insert(key, c);
+
+            position.push_back(heap.size());
+            heap.push_back(c);
+            sift_up(heap.size() - 1);
+
+            return;
+        }
+
+        //replace the key with the smallest count
+        unsigned c = heap[0];
+        Counter& victim = counters[c];
+
+        index._remove(victim.key);
+
+        victim = Counter{make_key<Key_Type>(key), victim.count + 1, victim.count};
+        index._insert(key, c);
+
+        sift_down(0);
+    }
+
+
+    //Return the k monitored keys with the largest counts, the largest count first
+    vector<Counter> top(size_t k) const
+    {
+        vector<Counter> best(counters);
+
+        sort(best.begin(), best.end(), [](const Counter& a, const Counter& b)
+        {
+            return a.count > b.count || (a.count == b.count && a.key < b.key);
+        });
+
+        if (best.size() > k)
+        {
+            best.resize(k);
+        }
+
+        return best;
+    }
+
+
+    //Return the number of monitored keys
+    unsigned get_number_OF_items() const
+    {
+        return counters.size();
+    }
+
+    //Return the number of bytes used by the counters, the heap, and the index
+    //The characters of keys stored outside the key objects are not counted
+    size_t memory_usage() const
+    {
+        return counters.capacity() * sizeof(Counter)
+               + (heap.capacity() + position.capacity()) * sizeof(unsigned)
+               + index.get_table_size() * sizeof(Item<Key_Type, unsigned>*)
+               + index.get_number_OF_items() * sizeof(Item<Key_Type, unsigned>);
+    }
+
+private:
+
+    unsigned capacity;
+    vector<Counter> counters;
+
+    //index of each monitored key in counters
+    HashTable<Key_Type, unsigned, Hash> index;
+
+    //min-heap of indexes in counters, ordered by count
+    //position[c] is the position of counters[c] in heap
+    vector<unsigned> heap;
+    vector<unsigned> position;
+
+
+    //Swap the heap entries at positions a and b
+    void swap_entries(size_t a, size_t b)
+    {
+        swap(heap[a], heap[b]);
+        position[heap[a]] = a;
+        position[heap[b]] = b;
+    }
+
+    unsigned long long count_at(size_t i) const
+    {
+        return counters[heap[i]].count;
+    }
+
+    void sift_up(size_t i)
+    {
+        while (i > 0 && count_at(i) < count_at((i - 1) / 2))
+        {
+            swap_entries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void sift_down(size_t i)
+    {
+        for (;;)
+        {
+            size_t least = i;
+            size_t l = 2 * i + 1, r = 2 * i + 2;
+
+            if (l < heap.size() && count_at(l) < count_at(least)) least = l;
+            if (r < heap.size() && count_at(r) < count_at(least)) least = r;
+
+            if (least == i)
+            {
+                return;
+            }
+
+            swap_entries(i, least);
+            i = least;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,278 @@
+/*
+  Course: TND004, Lab 2
+  Description: save a HashTable with string keys to a binary file (snapshot),
+              and template class Snapshot_Table to search a snapshot mapped in memory
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "hashTable.h"
+#include "hashFunctions.h"
+#include "mappedFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+
+/* ********************************** *
+* Snapshot file layout                *
+* *********************************** */
+
+//A snapshot file has three parts: a header, an array of slots, and the characters of the keys
+//The slots form an open addressing table with linear probing and a power of two size,
+//so a mapped snapshot can be searched as it is: nothing is parsed nor inserted
+//All positions are offsets from the start of the file (position independent)
+//The keys are hashed with Wy_Hash, so a snapshot does not depend on the hash functor
+//of the table that was saved
+
+const char SNAPSHOT_MAGIC[8] = {'H', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+
+struct Snapshot_Header
+{
+    char magic[8];
+    uint64_t value_size;    //sizeof(Value_Type), to detect a wrong value type
+    uint64_t n_slots;       //a power of two
+    uint64_t n_items;
+    uint64_t slots_offset;
+    uint64_t keys_offset;
+    uint64_t keys_size;
+};
+
+//A slot of a snapshot, empty if key_length == SNAPSHOT_EMPTY
+const uint32_t SNAPSHOT_EMPTY = 0xffffffff;
+
+template <typename Value_Type>
+struct Snapshot_Slot
+{
+    uint64_t hash;
+    uint64_t key_offset;    //offset of the key characters in the keys part
+    uint32_t key_length;
+    Value_Type value;
+};
+
+
+//Save table to file fileName
+//Key_Type must be convertible to string_view, and Value_Type trivially copyable
+//Return false if the file could not be written
+template <typename Key_Type, typename Value_Type, typename Hash, typename Size_Policy, typename Storage>
+bool save_snapshot(const HashTable<Key_Type, Value_Type, Hash, Size_Policy, Storage>& table, const string& fileName)
+{
+    static_assert(is_trivially_copyable<Value_Type>::value, "snapshot values are copied as bytes");
+
+    typedef Snapshot_Slot<Value_Type> Slot;
+
+    const uint64_t n_items = table.get_number_OF_items();
+
+    uint64_t n_slots = 1;
+    while (n_slots < 2 * n_items) n_slots <<= 1; //load factor at most 0.5
+
+    vector<Slot> slots(n_slots);
+    string keys;
+    Wy_Hash wy;
+
+    //zero the padding bytes too, so that no uninitialized memory is written to the file
+    memset((void*) slots.data(), 0, n_slots * sizeof(Slot));
+
+    for (Slot& s : slots)
+    {
+        s.key_length = SNAPSHOT_EMPTY;
+    }
+
+    table.for_each([&](const Key_Type& key, const Value_Type& v)
+    {
+        string_view k = key;
+        uint64_t hv = wy(k);
+        uint64_t idx = mix64(hv) & (n_slots - 1);
+
+        while (slots[idx].key_length != SNAPSHOT_EMPTY)
+        {
+            idx = (idx + 1) & (n_slots - 1);
+        }
+
+        slots[idx].hash = hv;
+        slots[idx].key_offset = keys.size();
+        slots[idx].key_length = k.size();
+        memcpy((void*) &slots[idx].value, (const void*) &v, sizeof v);
+
+        keys.append(k.data(), k.size());
+    });
+
+    Snapshot_Header header;
+
+    //the slots are read in place, so they start at a multiple of their alignment
+    const uint64_t slots_offset = (sizeof header + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+    const string padding(slots_offset - sizeof header, '\0');
+
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+    header.value_size = sizeof(Value_Type);
+    header.n_slots = n_slots;
+    header.n_items = n_items;
+    header.slots_offset = slots_offset;
+    header.keys_offset = header.slots_offset + n_slots * sizeof(Slot);
+    header.keys_size = keys.size();
+
+    ofstream file_out(fileName, ios::binary);
+
+    if (!file_out)
+    {
+        return false;
+    }
+
+    file_out.write((const char*) &header, sizeof header);
+    file_out.write(padding.data(), padding.size());
+    file_out.write((const char*) slots.data(), n_slots * sizeof(Slot));
+    file_out.write(keys.data(), keys.size());
+
+    return (bool) file_out;
+}
+
+
+/* ********************************** *
+* Class Snapshot_Table                *
+* *********************************** */
+
+//Template class to represent a read-only table loaded from a snapshot file
+//The file is mapped in memory and searched in place, so loading takes no time
+//whatever the number of items
+template <typename Value_Type>
+class Snapshot_Table
+{
+public:
+
+    //Map the snapshot file fileName
+    //The header is checked against the size of the file, so that the slots and the keys
+    //lie inside the mapping; the key of a slot is checked when it is used
+    explicit Snapshot_Table(const string& fileName)
+        : file(fileName, false), header(nullptr), slots(nullptr), keys(nullptr)
+    {
+        if (!file.is_open() || file.size() < sizeof(Snapshot_Header))
+        {
+            return;
+        }
+
+        const Snapshot_Header* hd = (const Snapshot_Header*) file.data();
+        const uint64_t size = file.size();
+
+        //each test only uses values bounded by the previous ones, so nothing overflows
+        bool ok = memcmp(hd->magic, SNAPSHOT_MAGIC, sizeof hd->magic) == 0
+                  && hd->value_size == sizeof(Value_Type)
+                  && hd->n_slots > 0 && (hd->n_slots & (hd->n_slots - 1)) == 0
+                  && hd->n_items < hd->n_slots
+                  && hd->slots_offset >= sizeof(Snapshot_Header) && hd->slots_offset <= size
+                  && hd->slots_offset % alignof(Slot) == 0
+                  && hd->n_slots <= (size - hd->slots_offset) / sizeof(Slot)
+                  && hd->keys_offset == hd->slots_offset + hd->n_slots * sizeof(Slot)
+                  && hd->keys_size <= size - hd->keys_offset;
+
+        if (ok)
+        {
+            header = hd;
+            slots = (const Slot*) (file.data() + hd->slots_offset);
+            keys = file.data() + hd->keys_offset;
+        }
+    }
+
+
+    //Return true if the snapshot could be mapped and is valid
+    bool is_open() const
+    {
+        return header != nullptr;
+    }
+
+
+    //Return number of items stored in the table
+    unsigned get_number_OF_items() const
+    {
+        return header ? header->n_items : 0;
+    }
+
+
+    //Return a pointer to the value associated with key
+    //If key does not exist in the table then nullptr is returned
+    const Value_Type* _find(string_view key) const
+    {
+        if (!header)
+        {
+            return nullptr;
+        }
+
+        uint64_t hv = Wy_Hash()(key);
+        uint64_t mask = header->n_slots - 1;
+        uint64_t idx = mix64(hv) & mask;
+
+        //at most n_slots probes, in case a damaged file has no empty slot
+        for (uint64_t i = 0; i < header->n_slots && slots[idx].key_length != SNAPSHOT_EMPTY; ++i, idx = (idx + 1) & mask)
+        {
+            const Slot& s = slots[idx];
+
+            if (s.hash == hv && s.key_length == key.size() && key_in_bounds(s)
+                && memcmp(keys + s.key_offset, key.data(), key.size()) == 0)
+            {
+                return &s.value;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    //Call f(key, value) for each item stored in the table
+    //A slot whose key lies outside the file is skipped
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        for (uint64_t i = 0; header && i < header->n_slots; ++i)
+        {
+            if (slots[i].key_length != SNAPSHOT_EMPTY && key_in_bounds(slots[i]))
+            {
+                f(string_view(keys + slots[i].key_offset, slots[i].key_length), slots[i].value);
+            }
+        }
+    }
+
+
+    //Display all items in table T to stream os
+    friend ostream& operator<<(ostream& os, const Snapshot_Table& T)
+    {
+        T.for_each([&os](string_view key, const Value_Type& v)
+        {
+            os << "key = " << "\"" << key << "\""
+               << setw(12) << "value = " << v << endl;
+        });
+
+        return os;
+    }
+
+private:
+
+    typedef Snapshot_Slot<Value_Type> Slot;
+
+    Mapped_File file;
+    const Snapshot_Header* header;
+    const Slot* slots;
+    const char* keys;
+
+    //Return true if the key of slot s lies inside the keys part of the file
+    bool key_in_bounds(const Slot& s) const
+    {
+        return s.key_offset <= header->keys_size && s.key_length <= header->keys_size - s.key_offset;
+    }
+
+    //Disable copy constructor!!
+    Snapshot_Table(const Snapshot_Table &) = delete;
+
+    //Disable assignment operator!!
+    const Snapshot_Table& operator=(const Snapshot_Table &) = delete;
+};
+
+#endif
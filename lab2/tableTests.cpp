@@ -0,0 +1,1327 @@
+/*
+  Course: TND004, Lab 2
+  Description: regression tests of the hash tables, the results are compared with a std::map
+              Build: g++ -std=c++17 -O2 -pthread tableTests.cpp -o tableTests
+              Run:   ./tableTests (the exit status is the number of failed checks)
+*/
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <utility>
+#include <sstream>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include <cmath>
+
+#include "hashTable.h"
+#include "asyncHashTable.h"
+#include "concurrentHashTable.h"
+#include "cuckooHashTable.h"
+#include "counterTable.h"
+#include "shardedHashTable.h"
+#include "frozenTable.h"
+#include "snapshot.h"
+#include "sketches.h"
+#include "hashFunctions.h"
+#include "textNormalize.h"
+
+using namespace std;
+
+const unsigned SEED = 1159241;
+
+//Number of failed checks
+static int failures = 0;
+
+
+//Count and report a failed check
+void check(bool ok, const string& test, const string& what)
+{
+    if (!ok)
+    {
+        cout << "FAILED " << test << ": " << what << endl;
+        failures++;
+    }
+}
+
+
+//Hash functor for int keys: the key itself
+struct Identity_Hash
+{
+    size_t operator()(int key) const
+    {
+        return key;
+    }
+};
+
+//Table sizes as given, reduced with modulo: the slot of key k is k % size
+struct Modulo_Sizing
+{
+    unsigned resize(unsigned n)
+    {
+        size = max(n, 1u);
+        return size;
+    }
+
+    unsigned slot(size_t hashVal) const
+    {
+        return hashVal % size;
+    }
+
+    unsigned size = 1;
+};
+
+
+//Return true if table has exactly the items of ref
+template <typename Table>
+bool same_items(Table& table, const map<int, int>& ref)
+{
+    if (table.get_number_OF_items() != ref.size())
+    {
+        return false;
+    }
+
+    for (const auto& kv : ref)
+    {
+        const int* v = table._find(kv.first);
+
+        if (!v || *v != kv.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* ********************************** *
+* Deleted slots and shrinking         *
+* *********************************** */
+
+//An item whose probe wraps around the end of the table is placed again by
+//purge_deleted: it must not move before the items of its cluster
+void test_purge_wrapped_cluster()
+{
+    HashTable<int, int, Identity_Hash, Modulo_Sizing> table(8);
+    map<int, int> ref;
+
+    table.disallowRehashing();
+
+    //slots: 6 -> 6, 7 -> 7, 14 -> 0, 1 -> 1, 2 -> 2, 8 -> 3
+    for (int k : {6, 7, 14, 1, 2, 8})
+    {
+        table._insert(k, k);
+        ref[k] = k;
+    }
+
+    table._remove(6);
+    table._remove(2);
+    ref.erase(6);
+    ref.erase(2);
+
+    table.purge_deleted();
+
+    check(same_items(table, ref), "purge_wrapped_cluster", "items lost by purge_deleted");
+    check(table.statistics().deleted == 0, "purge_wrapped_cluster", "deleted slots left");
+}
+
+
+//Random insertions and removals in a small table of fixed size, purged often
+//All items are searched after each purge, before any other operation
+void test_purge_churn()
+{
+    for (unsigned seed = SEED; seed < SEED + 3; ++seed)
+    {
+        HashTable<int, int, Identity_Hash, Modulo_Sizing> table(16);
+        map<int, int> ref;
+        mt19937 gen(seed);
+        unsigned lost = 0;
+
+        table.disallowRehashing();
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            int k = gen() % 64;
+
+            if (gen() % 2 && ref.size() < 12)
+            {
+                table._insert(k, i);
+                ref[k] = i;
+            }
+            else
+            {
+                table._remove(k);
+                ref.erase(k);
+            }
+
+            if (i % 5 == 0)
+            {
+                table.purge_deleted();
+
+                for (const auto& kv : ref)
+                {
+                    lost += !table.peek(kv.first);
+                }
+            }
+        }
+
+        check(lost == 0, "purge_churn", to_string(lost) + " items lost with seed " + to_string(seed));
+    }
+}
+
+
+//Random insertions, removals, and searches, compared with a std::map
+//The table grows, shrinks, and reuses or purges its deleted slots
+template <typename Size_Policy>
+void test_churn(const string& name, double max_load)
+{
+    for (unsigned seed = SEED; seed < SEED + 3; ++seed)
+    {
+        HashTable<int, int, std::hash<int>, Size_Policy> table(7);
+        map<int, int> ref;
+        mt19937 gen(seed);
+        uniform_int_distribution<int> key(0, 2000);
+        unsigned lost = 0;
+
+        table.set_max_load_factor(max_load);
+
+        for (int i = 0; i < 200000; ++i)
+        {
+            int k = key(gen);
+
+            switch (gen() % 4)
+            {
+                case 0:
+                    table._insert(k, i);
+                    ref[k] = i;
+                    break;
+                case 1:
+                    table[k]++;
+                    ref[k]++;
+                    break;
+                case 2:
+                    check(table._remove(k) == (ref.erase(k) == 1), name, "_remove");
+                    break;
+                default:
+                {
+                    const int* v = table._find(k);
+                    auto it = ref.find(k);
+
+                    lost += (v == nullptr) != (it == ref.end()) || (v && *v != it->second);
+                }
+            }
+        }
+
+        check(lost == 0, name, to_string(lost) + " wrong searches with seed " + to_string(seed));
+        check(same_items(table, ref), name, "items differ with seed " + to_string(seed));
+    }
+}
+
+
+//The sizing policies round a request up, and give their largest size to larger requests
+void test_sizing_limits()
+{
+    Prime_Sizing prime;
+    Pow2_Sizing pow2;
+    Fastrange_Sizing fastrange;
+
+    check(prime.resize(5) == 5 && pow2.resize(5) == 8 && fastrange.resize(5) == 8, "sizing_limits", "small sizes");
+
+    for (unsigned n : {MAX_POW2_SIZE - 1, MAX_POW2_SIZE, MAX_POW2_SIZE + 1, UINT32_MAX})
+    {
+        check(pow2.resize(n) == MAX_POW2_SIZE, "sizing_limits", "Pow2_Sizing::resize(" + to_string(n) + ")");
+        check(fastrange.resize(n) == MAX_POW2_SIZE, "sizing_limits", "Fastrange_Sizing::resize(" + to_string(n) + ")");
+        check(prime.resize(n) >= min(n, 4294967291u), "sizing_limits", "Prime_Sizing::resize(" + to_string(n) + ")");
+    }
+
+    check(pow2.slot(~size_t(0)) < MAX_POW2_SIZE && fastrange.slot(~size_t(0)) < MAX_POW2_SIZE, "sizing_limits", "slot out of range");
+}
+
+
+//Removing most items shrinks the table, but not below its initial size
+void test_shrink_on_remove()
+{
+    const int N = 100000;
+    const int INITIAL_SIZE = 1000;
+
+    HashTable<int, int, std::hash<int>> table(INITIAL_SIZE);
+    map<int, int> ref;
+
+    for (int k = 0; k < N; ++k)
+    {
+        table._insert(k, k);
+        ref[k] = k;
+    }
+
+    unsigned full_size = table.get_table_size();
+
+    for (int k = 0; k < N - 10; ++k)
+    {
+        table._remove(k);
+        ref.erase(k);
+    }
+
+    check(table.get_table_size() < full_size / 8, "shrink_on_remove", "the table did not shrink");
+    check(table.get_table_size() >= (unsigned) INITIAL_SIZE, "shrink_on_remove", "shrunk below the initial size");
+    check(same_items(table, ref), "shrink_on_remove", "items differ after shrinking");
+
+    table.shrink_to_fit();
+
+    check(table.loadFactor() <= MAX_LOAD_FACTOR, "shrink_on_remove", "shrink_to_fit above the max load factor");
+    check(same_items(table, ref), "shrink_on_remove", "items differ after shrink_to_fit");
+}
+
+
+//Operations on a table without empty slots: no probe finds an empty slot
+void test_full_table()
+{
+    HashTable<int, int, Identity_Hash, Modulo_Sizing> table(7);
+    map<int, int> ref;
+
+    table.disallowRehashing();
+
+    for (int k = 0; k < 7; ++k)
+    {
+        table._insert(k, k);
+        ref[k] = k;
+    }
+
+    check(table._find(100) == nullptr, "full_table", "_find of a missing key");
+    check(!table._remove(100), "full_table", "_remove of a missing key");
+
+    //a deleted slot is reused, then the full table grows
+    table._remove(3);
+    table._insert(10, 10);
+    ref.erase(3);
+    ref[10] = 10;
+
+    check(table.statistics().deleted == 0, "full_table", "the reused deleted slot is still counted");
+
+    table[20]++;
+    table._insert(21, 21);
+    ref[20]++;
+    ref[21] = 21;
+
+    check(table.get_table_size() > 7, "full_table", "the full table did not grow");
+    check(same_items(table, ref), "full_table", "items differ");
+
+    //the max load factor is kept below 1
+    HashTable<int, int, std::hash<int>> dense(7);
+    map<int, int> dense_ref;
+
+    dense.set_max_load_factor(1.5);
+
+    for (int k = 0; k < 1000; ++k)
+    {
+        dense[k] = k;
+        dense_ref[k] = k;
+        dense._find(-k - 1);
+    }
+
+    check(dense.loadFactor() <= MAX_USABLE_LOAD_FACTOR, "full_table", "load factor above the limit");
+    check(same_items(dense, dense_ref), "full_table", "items differ with max load factor 1.5");
+}
+
+
+/* ********************************** *
+* reserve and bulk_insert             *
+* *********************************** */
+
+//After reserve(n), n items are inserted without re-hashing
+void test_reserve()
+{
+    const int N = 50000;
+
+    HashTable<int, int, std::hash<int>> table(7);
+    map<int, int> ref;
+
+    table.reserve(N);
+
+    unsigned rehashes = table.statistics().rehash_count;
+
+    for (int k = 0; k < N; ++k)
+    {
+        table._insert(k, -k);
+        ref[k] = -k;
+    }
+
+    check(table.statistics().rehash_count == rehashes, "reserve", "re-hashed after reserve");
+    check(same_items(table, ref), "reserve", "items differ");
+}
+
+
+//bulk_insert gives the same items as _insert in a loop, also with several threads
+void test_bulk_insert(unsigned n_threads)
+{
+    const string name = "bulk_insert(" + to_string(n_threads) + " threads)";
+    const int N = 100000;
+
+    HashTable<int, int, std::hash<int>> table(7);
+    map<int, int> ref;
+    mt19937 gen(SEED);
+
+    table.set_rehash_threads(n_threads);
+
+    //some keys are already in the table, and some are repeated in the range
+    for (int k = 0; k < 1000; ++k)
+    {
+        table._insert(k, 0);
+        ref[k] = 0;
+    }
+
+    vector<pair<int, int>> pairs;
+
+    for (int i = 0; i < N; ++i)
+    {
+        pairs.push_back({(int) (gen() % (N / 2)), i});
+    }
+
+    table.bulk_insert(pairs.begin(), pairs.end());
+
+    for (const auto& p : pairs)
+    {
+        ref[p.first] = p.second;
+    }
+
+    check(same_items(table, ref), name, "items differ");
+
+    //a second range of new keys, in a larger table
+    pairs.clear();
+
+    for (int i = 0; i < N; ++i)
+    {
+        pairs.push_back({N + i, i});
+        ref[N + i] = i;
+    }
+
+    table.bulk_insert(pairs.begin(), pairs.end());
+
+    check(same_items(table, ref), name, "items differ after the second range");
+}
+
+
+/* ********************************** *
+* ShardedHashTable                    *
+* *********************************** */
+
+//Parse the lines key = "k"    value = v written by operator<<
+//Return false if a key is written twice
+bool parse_items(const string& text, map<int, int>& items)
+{
+    istringstream is(text);
+    string line;
+
+    items.clear();
+
+    while (getline(is, line))
+    {
+        size_t q = line.find('"');
+        int k = stoi(line.substr(q + 1));
+        int v = stoi(line.substr(line.rfind('=') + 1));
+
+        if (!items.emplace(k, v).second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//The shards are merged into the sums of their values, and merged again
+void test_sharded_merge(unsigned n_threads)
+{
+    const string name = "sharded_merge(" + to_string(n_threads) + " threads)";
+    const unsigned N_SHARDS = 4;
+
+    ShardedHashTable<int, int, std::hash<int>> table(7, N_SHARDS);
+    map<int, int> ref;
+    mt19937 gen(SEED);
+
+    for (unsigned i = 0; i < N_SHARDS; ++i)
+    {
+        for (int j = 0; j < 20000; ++j)
+        {
+            int k = gen() % 5000;
+
+            table.shard(i)[k] += j;
+            ref[k] += j;
+        }
+    }
+
+    table.merge(n_threads);
+
+    map<int, int> merged;
+    ostringstream os;
+    os << table;
+
+    check(table.get_number_OF_items() == ref.size(), name, "number of items");
+    check(parse_items(os.str(), merged) && merged == ref, name, "merged items differ");
+
+    map<int, int> visited;
+
+    table.for_each([&visited](int key, int v) { visited[key] = v; });
+
+    check(visited == ref, name, "for_each differs");
+
+    //a second merge keeps the items, in other partitions
+    table.merge(n_threads + 1);
+
+    ostringstream again;
+    again << table;
+
+    check(table.get_number_OF_items() == ref.size(), name, "number of items after a second merge");
+    check(parse_items(again.str(), merged) && merged == ref, name, "items differ after a second merge");
+}
+
+
+/* ********************************** *
+* CuckooHashTable                     *
+* *********************************** */
+
+//Keys with the same hash value have the same two buckets: the keys that do not fit
+//are stashed, and the table does not grow
+void test_cuckoo_collisions()
+{
+    const int N = 1000;
+
+    CuckooHashTable<string, int, Horner_Hash> table(16);
+    map<string, int> ref;
+
+    //37*'b' + 'z' == 37*'c' + 'U', so all words made of these blocks collide
+    for (int i = 0; i < N; ++i)
+    {
+        string k;
+
+        for (int b = 0; b < 10; ++b)
+        {
+            k += ((i >> b) & 1) ? "cU" : "bz";
+        }
+
+        table[k] += i;
+        ref[k] += i;
+    }
+
+    check(table.get_number_OF_items() == ref.size(), "cuckoo_collisions", "number of items");
+    check(table.get_table_size() <= 64, "cuckoo_collisions", "the table grew for colliding keys");
+    check(table.get_stash_size() > 0, "cuckoo_collisions", "no key was stashed");
+
+    bool same = true;
+
+    for (const auto& kv : ref)
+    {
+        const int* v = table._find(kv.first);
+
+        same = same && v && *v == kv.second;
+    }
+
+    check(same, "cuckoo_collisions", "items differ");
+
+    for (const auto& kv : ref)
+    {
+        check(table._remove(kv.first), "cuckoo_collisions", "_remove of " + kv.first);
+    }
+
+    check(table.get_number_OF_items() == 0 && table.get_stash_size() == 0, "cuckoo_collisions", "items left");
+}
+
+
+//Random insertions, removals, and searches, compared with a std::map
+void test_cuckoo_churn()
+{
+    CuckooHashTable<int, int> table(7);
+    map<int, int> ref;
+    mt19937 gen(SEED);
+    unsigned lost = 0;
+
+    for (int i = 0; i < 200000; ++i)
+    {
+        int k = gen() % 20000;
+
+        switch (gen() % 3)
+        {
+            case 0:
+                table[k] += i;
+                ref[k] += i;
+                break;
+            case 1:
+                check(table._remove(k) == (ref.erase(k) == 1), "cuckoo_churn", "_remove");
+                break;
+            default:
+            {
+                const int* v = table._find(k);
+                auto it = ref.find(k);
+
+                lost += (v == nullptr) != (it == ref.end()) || (v && *v != it->second);
+            }
+        }
+    }
+
+    check(lost == 0, "cuckoo_churn", to_string(lost) + " wrong searches");
+    check(same_items(table, ref), "cuckoo_churn", "items differ");
+}
+
+
+/* ********************************** *
+* Frozen_Table                        *
+* *********************************** */
+
+//Every key of a frozen table is found in its slot, and a missing key is not found
+void test_freeze()
+{
+    HashTable<string, int, Wy_Hash> table(7);
+    map<string, int> ref;
+    mt19937 gen(SEED);
+
+    for (int i = 0; i < 5000; ++i)
+    {
+        string k = "w" + to_string(gen() % 100000);
+
+        table[k] += i;
+        ref[k] += i;
+    }
+
+    auto frozen = freeze(table);
+
+    check(frozen.get_number_OF_items() == ref.size(), "freeze", "number of items");
+
+    bool same = true;
+
+    for (const auto& kv : ref)
+    {
+        const int* v = frozen._find(kv.first);
+
+        same = same && v && *v == kv.second;
+    }
+
+    check(same, "freeze", "items differ");
+    check(frozen._find(string("missing")) == nullptr, "freeze", "_find of a missing key");
+}
+
+
+//Keys with the same hash value are frozen too, and found by comparing the keys
+void test_freeze_collisions()
+{
+    HashTable<string, int, Horner_Hash> table(7);
+    map<string, int> ref;
+
+    //37*'a' + 'Z' == 37*'b' + '5', and 37*'b' + 'z' == 37*'c' + 'U'
+    ref["aZ"] = 1;
+    ref["b5"] = 2;
+    ref["c"] = 3;
+
+    //groups of colliding keys of 6 blocks, except the last key of each group
+    for (int i = 0; i < 63; ++i)
+    {
+        string k;
+
+        for (int b = 0; b < 6; ++b)
+        {
+            k += ((i >> b) & 1) ? "cU" : "bz";
+        }
+
+        ref[k] = i;
+        ref["w" + to_string(i)] = -i;
+    }
+
+    for (const auto& kv : ref)
+    {
+        table[kv.first] = kv.second;
+    }
+
+    auto frozen = freeze(table);
+
+    check(frozen.get_number_OF_items() == ref.size(), "freeze_collisions", "number of items");
+
+    bool same = true;
+
+    for (const auto& kv : ref)
+    {
+        const int* v = frozen._find(kv.first);
+
+        same = same && v && *v == kv.second;
+    }
+
+    check(same, "freeze_collisions", "colliding keys not found");
+
+    map<string, int> visited;
+
+    frozen.for_each([&visited](const string& key, int v) { visited[key] = v; });
+
+    check(visited == ref, "freeze_collisions", "for_each differs");
+
+    //same hash value as the frozen keys, but not in the table
+    check(frozen._find(string("cUcUcUcUcUcU")) == nullptr, "freeze_collisions", "_find of a missing colliding key");
+}
+
+
+/* ********************************** *
+* Snapshot_Table                      *
+* *********************************** */
+
+const string SNAPSHOT_FILE = "tableTests_snapshot.bin";
+
+//Overwrite the 8 bytes at position pos of file fileName with x
+void patch_file(const string& fileName, uint64_t pos, uint64_t x)
+{
+    fstream file(fileName, ios::in | ios::out | ios::binary);
+
+    file.seekp(pos);
+    file.write((const char*) &x, sizeof x);
+}
+
+
+//A snapshot is searched as the saved table, and a damaged snapshot is rejected
+//or searched without reading outside the mapping
+void test_snapshot()
+{
+    typedef Snapshot_Slot<int> Slot;
+
+    HashTable<string, int> table(7);
+    map<string, int> ref;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        string k = "w" + to_string(i * 7919 % 1009);
+
+        table[k] += i;
+        ref[k] += i;
+    }
+
+    check(save_snapshot(table, SNAPSHOT_FILE), "snapshot", "save_snapshot failed");
+
+    uint64_t n_slots = 0;
+    uint64_t slots_offset = 0;
+
+    {
+        Snapshot_Table<int> snap(SNAPSHOT_FILE);
+
+        check(snap.is_open(), "snapshot", "the snapshot was not loaded");
+        check(snap.get_number_OF_items() == ref.size(), "snapshot", "number of items");
+
+        bool same = true;
+
+        for (const auto& kv : ref)
+        {
+            const int* v = snap._find(kv.first);
+
+            same = same && v && *v == kv.second;
+        }
+
+        check(same, "snapshot", "items differ");
+        check(snap._find("missing") == nullptr, "snapshot", "_find of a missing key");
+
+        ifstream file(SNAPSHOT_FILE, ios::binary);
+        Snapshot_Header header;
+
+        file.read((char*) &header, sizeof header);
+        n_slots = header.n_slots;
+        slots_offset = header.slots_offset;
+    }
+
+    //slots past the end of the file
+    patch_file(SNAPSHOT_FILE, offsetof(Snapshot_Header, n_slots), n_slots << 40);
+    check(!Snapshot_Table<int>(SNAPSHOT_FILE).is_open(), "snapshot", "too many slots accepted");
+
+    patch_file(SNAPSHOT_FILE, offsetof(Snapshot_Header, n_slots), n_slots);
+    patch_file(SNAPSHOT_FILE, offsetof(Snapshot_Header, slots_offset), ~0ull - 7);
+    check(!Snapshot_Table<int>(SNAPSHOT_FILE).is_open(), "snapshot", "slots offset past the end accepted");
+
+    //the keys of every slot outside the file
+    patch_file(SNAPSHOT_FILE, offsetof(Snapshot_Header, slots_offset), slots_offset);
+
+    for (uint64_t i = 0; i < n_slots; ++i)
+    {
+        patch_file(SNAPSHOT_FILE, slots_offset + i * sizeof(Slot) + offsetof(Slot, key_offset), 1ull << 62);
+    }
+
+    {
+        Snapshot_Table<int> snap(SNAPSHOT_FILE);
+        unsigned visited = 0;
+
+        check(snap.is_open(), "snapshot", "the header was damaged");
+
+        snap.for_each([&visited](string_view, int) { ++visited; });
+
+        check(visited == 0, "snapshot", "keys outside the file visited");
+        check(snap._find(ref.begin()->first) == nullptr, "snapshot", "key outside the file found");
+    }
+
+    remove(SNAPSHOT_FILE.c_str());
+}
+
+
+/* ********************************** *
+* Async_HashTable                     *
+* *********************************** */
+
+//Random operations compared with a std::map, while the table is re-hashed in the background
+//When a re-hash is in progress, the key is also updated, removed, inserted again, and
+//maybe removed again, so that the delta has keys that are changed several times before
+//it is applied
+void test_async_churn()
+{
+    Async_HashTable<int, int> table(7);
+    map<int, int> ref;
+    mt19937 gen(SEED);
+    unsigned during = 0, lost = 0;
+
+    auto same_value = [&](int k)
+    {
+        const int* v = table._find(k);
+        auto it = ref.find(k);
+
+        return (v == nullptr) == (it == ref.end()) && (!v || *v == it->second);
+    };
+
+    for (int i = 0; i < 300000; ++i)
+    {
+        int k = gen() % 50000;
+
+        switch (gen() % 4)
+        {
+            case 0:
+                table[k] += i;
+                ref[k] += i;
+                break;
+            case 1:
+                table._insert(k, i);
+                ref[k] = i;
+                break;
+            case 2:
+                check(table._remove(k) == (ref.erase(k) == 1), "async_churn", "_remove");
+                break;
+            default:
+                lost += !same_value(k);
+        }
+
+        if (table.rehashing())
+        {
+            during++;
+
+            table[k] += 1;
+            ref[k] += 1;
+            lost += !same_value(k);
+
+            check(table._remove(k), "async_churn", "_remove of a key of the delta");
+            ref.erase(k);
+            lost += !same_value(k);
+
+            table._insert(k, -i);
+            ref[k] = -i;
+            table[k] += 2;
+            ref[k] += 2;
+            lost += !same_value(k);
+
+            //half of the keys are left removed in the delta
+            if (gen() % 2)
+            {
+                check(table._remove(k), "async_churn", "_remove of a key of the delta");
+                ref.erase(k);
+            }
+        }
+
+        lost += table.get_number_OF_items() != ref.size();
+
+        //wait, sometimes, while the background thread is still building
+        if (i % 50000 == 0)
+        {
+            table.wait();
+            check(!table.rehashing(), "async_churn", "re-hash in progress after wait()");
+        }
+    }
+
+    check(during > 0, "async_churn", "never re-hashed");
+    check(lost == 0, "async_churn", to_string(lost) + " wrong searches or sizes");
+
+    map<int, int> visited;
+
+    table.for_each([&visited](int key, int v) { visited[key] = v; });
+
+    check(visited == ref, "async_churn", "for_each differs during a re-hash");
+
+    table.wait();
+
+    check(!table.rehashing(), "async_churn", "re-hash in progress after wait()");
+    check(same_items(table, ref), "async_churn", "items differ after wait()");
+}
+
+
+/* ********************************** *
+* Counter_Table                       *
+* *********************************** */
+
+//Return true if table has exactly the counts of ref, searched and visited
+template <typename Table>
+bool same_counts(Table& table, const map<string, uint32_t>& ref)
+{
+    if (table.get_number_OF_items() != ref.size())
+    {
+        return false;
+    }
+
+    for (const auto& kv : ref)
+    {
+        const uint32_t* c = table._find(kv.first);
+
+        if (!c || *c != kv.second)
+        {
+            return false;
+        }
+    }
+
+    map<string, uint32_t> visited;
+
+    table.for_each([&visited](string_view key, uint32_t c) { visited[string(key)] = c; });
+
+    return visited == ref;
+}
+
+
+//Return key number id, with a length of 1 to 40 characters
+//The lengths 22, 23, and 24 are around MAX_INLINE, the longest key stored in a slot
+string counter_key(unsigned id)
+{
+    const unsigned lengths[] = {1, 22, 23, 24, 40};
+
+    string k = to_string(id);
+    k.resize(max<size_t>(k.size(), lengths[id % 5]), '.');
+
+    return k;
+}
+
+
+//Random increments, removals, and searches, compared with a std::map
+//Keys on both sides of the inline limit, with colliding hash values and tags, and
+//a small table that cannot re-hash, so that deleted slots are reused and the table fills
+template <typename Hash>
+void test_counter_churn(const string& name, vector<string> (*make_keys)(), int table_size, bool rehash)
+{
+    const vector<string> keys = make_keys();
+
+    Counter_Table<Hash> table(table_size);
+    map<string, uint32_t> ref;
+    mt19937 gen(SEED);
+    unsigned lost = 0;
+
+    if (!rehash) table.disallowRehashing();
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        const string& k = keys[gen() % keys.size()];
+
+        switch (gen() % 3)
+        {
+            case 0:
+                table[k] += i;
+                ref[k] += i;
+                break;
+            case 1:
+                check(table._remove(k) == (ref.erase(k) == 1), name, "_remove of " + k);
+                break;
+            default:
+            {
+                const uint32_t* c = table._find(k);
+                auto it = ref.find(k);
+
+                lost += (c == nullptr) != (it == ref.end()) || (c && *c != it->second);
+            }
+        }
+    }
+
+    check(lost == 0, name, to_string(lost) + " wrong searches");
+    check(same_counts(table, ref), name, "counts differ");
+
+    //all keys removed, then inserted again in the deleted slots
+    for (const auto& kv : ref)
+    {
+        check(table._remove(kv.first), name, "_remove of " + kv.first);
+    }
+
+    check(table.get_number_OF_items() == 0, name, "keys left after removing all");
+
+    for (const auto& kv : ref)
+    {
+        table[kv.first] = kv.second;
+    }
+
+    check(same_counts(table, ref), name, "counts differ after inserting again");
+}
+
+
+vector<string> counter_keys()
+{
+    vector<string> keys;
+
+    for (unsigned id = 0; id < 3000; ++id) keys.push_back(counter_key(id));
+
+    return keys;
+}
+
+vector<string> few_counter_keys()
+{
+    vector<string> keys;
+
+    for (unsigned id = 0; id < 20; ++id) keys.push_back(counter_key(id));
+
+    return keys;
+}
+
+//Keys of 11 and 12 blocks "bz" or "cU": 22 and 24 characters, and with Horner_Hash
+//all keys with the same number of blocks have the same hash value and the same tag
+vector<string> colliding_counter_keys()
+{
+    vector<string> keys;
+
+    for (unsigned blocks = 11; blocks <= 12; ++blocks)
+    {
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            string k;
+
+            for (unsigned b = 0; b < blocks; ++b)
+            {
+                k += ((i >> (b % 7)) & 1) ? "cU" : "bz";
+            }
+
+            keys.push_back(k);
+        }
+    }
+
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    return keys;
+}
+
+
+/* ********************************** *
+* ConcurrentHashTable                 *
+* *********************************** */
+
+//n_threads threads count the same words with increment() and update(),
+//the counts must be the sequential counts
+void test_concurrent_increment(unsigned n_threads, bool rehash)
+{
+    const string name = "concurrent_increment(" + to_string(n_threads) + (rehash ? ")" : ", no rehash)");
+    const unsigned N = 200000;
+
+    ConcurrentHashTable<string, int, Horner_Hash> table(7, 8);
+    map<string, int> ref;
+    vector<string> words(N);
+    mt19937 gen(SEED);
+
+    if (!rehash) table.disallowRehashing();
+
+    for (string& w : words)
+    {
+        //a few frequent words, and many rare ones
+        unsigned id = (gen() % 4 == 0) ? gen() % 5 : gen() % 20000;
+
+        w = "w" + to_string(id);
+        ref[w] += 2;
+    }
+
+    vector<thread> workers;
+
+    for (unsigned t = 0; t < n_threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            for (unsigned i = t; i < N; i += n_threads)
+            {
+                table.increment(string_view(words[i]));
+                table.update(words[i], [](int& v) { v++; });
+            }
+        });
+    }
+
+    for (thread& w : workers) w.join();
+
+    check(table.get_number_OF_items() == ref.size(), name, "number of items");
+
+    bool same = true;
+
+    for (const auto& kv : ref)
+    {
+        int v = 0;
+
+        same = same && table._find(kv.first, v) && v == kv.second;
+    }
+
+    check(same, name, "counts differ from the sequential counts");
+
+    int v = 0;
+
+    check(!table._find(string("missing"), v), name, "_find of a missing key");
+    check(table._remove(ref.begin()->first) && !table._find(ref.begin()->first, v), name, "_remove");
+}
+
+
+/* ********************************** *
+* Text kernels                        *
+* *********************************** */
+
+//The AVX2 kernels give the same results as the scalar kernels, on random bytes
+//(including bytes >= 0x80) and for all tail lengths after the blocks of 32 characters
+void test_text_kernels()
+{
+#if defined(TEXT_NORMALIZE_AVX2)
+    if (!cpu_has_avx2())
+    {
+        cout << "text_kernels: no AVX2, skipped" << endl;
+        return;
+    }
+
+    const Byte_Set sets[] = {Byte_Set(".,!?:\"();"), Byte_Set(" \t\n\v\f\r"), Byte_Set("aZ~")};
+    mt19937 gen(SEED);
+    unsigned lowered = 0, found = 0, removed = 0;
+
+    for (int round = 0; round < 20; ++round)
+    {
+        for (size_t n = 0; n < 3 * 32; ++n)
+        {
+            string text(n, ' ');
+
+            //random bytes, or mostly letters with a few bytes of the sets
+            for (char& c : text)
+            {
+                c = (round % 2) ? (char) gen() : "abcXYZ.,( \n~\xe9"[gen() % 13];
+            }
+
+            string a = text, b = text;
+
+            lowercase_ascii_scalar(&a[0], n);
+            lowercase_ascii_avx2(&b[0], n);
+            lowered += a != b;
+
+            for (const Byte_Set& set : sets)
+            {
+                found += set.find_first_scalar(text.data(), n) != set.find_first_avx2(text.data(), n);
+
+                a = b = text;
+
+                size_t na = set.remove_from_scalar(&a[0], n);
+                size_t nb = set.remove_from_avx2(&b[0], n);
+
+                removed += na != nb || a.compare(0, na, b, 0, nb) != 0;
+            }
+        }
+    }
+
+    check(lowered == 0, "text_kernels", to_string(lowered) + " lowercase_ascii differences");
+    check(found == 0, "text_kernels", to_string(found) + " find_first differences");
+    check(removed == 0, "text_kernels", to_string(removed) + " remove_from differences");
+#endif
+}
+
+
+/* ********************************** *
+* Sketches                            *
+* *********************************** */
+
+//Return a stream of n words with skewed frequencies, word i has a weight 1/(i+1)
+vector<string> skewed_words(size_t n, unsigned n_words)
+{
+    vector<double> weights(n_words);
+
+    for (unsigned i = 0; i < n_words; ++i) weights[i] = 1.0 / (i + 1);
+
+    discrete_distribution<unsigned> word(weights.begin(), weights.end());
+    mt19937 gen(SEED);
+    vector<string> stream(n);
+
+    for (string& w : stream) w = "w" + to_string(word(gen));
+
+    return stream;
+}
+
+
+//Count-Min never underestimates, and overestimates by more than e/width * total
+//for at most a fraction exp(-depth) of the keys, here with margin
+//Keys that collide with Horner_Hash are counted too
+void test_count_min()
+{
+    const unsigned WIDTH = 512, DEPTH = 4;
+
+    vector<string> stream = skewed_words(200000, 20000);
+
+    //each block of 4 characters "bzbz", "bzcU", ... has the same Horner hash value
+    for (int i = 0; i < 20000; ++i)
+    {
+        stream.push_back(string((i % 7) & 1 ? "cU" : "bz") + ((i % 7) & 2 ? "cU" : "bz"));
+    }
+
+    Count_Min<string, Wy_Hash> sketch(WIDTH, DEPTH);
+    map<string, unsigned> exact;
+
+    for (const string& w : stream)
+    {
+        sketch.increment(w);
+        exact[w]++;
+    }
+
+    const double bound = exp(1.0) / WIDTH * stream.size();
+    unsigned under = 0, over = 0, colliding = 0;
+
+    for (const auto& kv : exact)
+    {
+        uint32_t e = sketch.estimate(kv.first);
+
+        under += e < kv.second;
+        over += e - kv.second > bound;
+        colliding += (kv.first[0] != 'w') && e - kv.second > bound;
+    }
+
+    check(sketch.get_total() == stream.size(), "count_min", "total");
+    check(under == 0, "count_min", to_string(under) + " underestimated keys");
+    check(over <= 3 * exp(-1.0 * DEPTH) * exact.size(), "count_min", to_string(over) + " keys above the error bound");
+    check(colliding == 0, "count_min", "keys with the same Horner hash value share their counters");
+}
+
+
+//The estimate of HyperLogLog is within 3 standard errors, 1.04 / sqrt(2^precision)
+void test_hyperloglog()
+{
+    const unsigned PRECISION = 12;
+    const double tolerance = 3 * 1.04 / sqrt(1 << PRECISION);
+
+    for (unsigned n : {100u, 1000u, 20000u, 200000u})
+    {
+        HyperLogLog<string, Wy_Hash> sketch(PRECISION);
+
+        //each key is added twice
+        for (unsigned r = 0; r < 2; ++r)
+        {
+            for (unsigned i = 0; i < n; ++i) sketch.add("k" + to_string(i));
+        }
+
+        double error = fabs(sketch.estimate() - n) / n;
+
+        check(error <= tolerance, "hyperloglog", "relative error " + to_string(error) + " for " + to_string(n) + " keys");
+    }
+}
+
+
+//Space-Saving: a count is too large by at most its error, every key more frequent
+//than total / capacity is monitored, and with a capacity of 10k the top k keys are exact
+void test_space_saving()
+{
+    const unsigned K = 20, CAPACITY = 10 * K;
+
+    vector<string> stream = skewed_words(200000, 20000);
+
+    Space_Saving<string, Horner_Hash> sketch(CAPACITY);
+    map<string, unsigned long long> exact;
+
+    for (const string& w : stream)
+    {
+        sketch.increment(w);
+        exact[w]++;
+    }
+
+    vector<Space_Saving<string, Horner_Hash>::Counter> all = sketch.top(CAPACITY);
+    map<string, unsigned long long> monitored;
+    unsigned wrong = 0;
+
+    for (const auto& c : all)
+    {
+        unsigned long long f = exact[c.key];
+
+        wrong += c.count < f || c.count - c.error > f;
+        monitored[c.key] = c.count;
+    }
+
+    unsigned missing = 0;
+
+    for (const auto& kv : exact)
+    {
+        missing += kv.second > stream.size() / CAPACITY && !monitored.count(kv.first);
+    }
+
+    check(sketch.get_number_OF_items() == CAPACITY, "space_saving", "number of monitored keys");
+    check(wrong == 0, "space_saving", to_string(wrong) + " counts outside [frequency, frequency + error]");
+    check(missing == 0, "space_saving", to_string(missing) + " frequent keys not monitored");
+
+    //the exact top K, by frequency then by key
+    vector<pair<unsigned long long, string>> ranked;
+
+    for (const auto& kv : exact) ranked.push_back({kv.second, kv.first});
+
+    sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b)
+    {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    vector<Space_Saving<string, Horner_Hash>::Counter> top = sketch.top(K);
+    bool same = top.size() == K;
+
+    for (unsigned i = 0; same && i < K; ++i)
+    {
+        same = top[i].key == ranked[i].second;
+    }
+
+    check(same, "space_saving", "top keys differ from the exact top keys");
+}
+
+
+int main()
+{
+    test_purge_wrapped_cluster();
+    test_purge_churn();
+
+    test_churn<Prime_Sizing>("churn(prime)", 0.8);
+    test_churn<Pow2_Sizing>("churn(pow2)", 0.8);
+    test_churn<Fastrange_Sizing>("churn(fastrange)", 0.8);
+    test_churn<Pow2_Sizing>("churn(pow2, default load)", MAX_LOAD_FACTOR);
+
+    test_sizing_limits();
+    test_shrink_on_remove();
+    test_full_table();
+
+    test_reserve();
+    test_bulk_insert(1);
+    test_bulk_insert(4);
+
+    test_concurrent_increment(1, true);
+    test_concurrent_increment(4, true);
+    test_concurrent_increment(4, false);
+
+    test_sharded_merge(1);
+    test_sharded_merge(4);
+
+    test_async_churn();
+
+    test_counter_churn<Wy_Hash>("counter_churn", counter_keys, 7, true);
+    test_counter_churn<Horner_Hash>("counter_churn(colliding)", colliding_counter_keys, 7, true);
+    test_counter_churn<Wy_Hash>("counter_churn(no rehash)", few_counter_keys, 23, false);
+    test_counter_churn<Wy_Hash>("counter_churn(full)", counter_keys, 7, false);
+
+    test_cuckoo_collisions();
+    test_cuckoo_churn();
+
+    test_freeze();
+    test_freeze_collisions();
+
+    test_snapshot();
+
+    test_text_kernels();
+
+    test_count_min();
+    test_hyperloglog();
+    test_space_saving();
+
+    if (failures == 0)
+    {
+        cout << "All tests passed" << endl;
+    }
+
+    return failures;
+}
@@ -14,7 +14,11 @@
 using namespace std;
 
 
-unsigned my_hash(string s, int tableSize);
+//Hash functor: sum of the characters
+struct My_Hash
+{
+    size_t operator()(const string& s) const;
+};
 
 int menu();
 
@@ -22,7 +26,7 @@ int menu();
 int main()
 {
     const int TABLE_SIZE = 7;
-    HashTable<string,int> table(TABLE_SIZE, my_hash);
+    HashTable<string,int,My_Hash> table(TABLE_SIZE);
 
     string key;
     const int* p_value = nullptr;
@@ -90,15 +94,13 @@ int main()
 }
 
 
-unsigned my_hash(string s, int tableSize)
+size_t My_Hash::operator()(const string& s) const
 {
     unsigned hashVal = 0;
 
     for(unsigned i = 0; i < s.length(); i++)
         hashVal += s[i];
 
-    hashVal %= tableSize;
-
     return hashVal;
 }
 
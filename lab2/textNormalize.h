@@ -0,0 +1,267 @@
+/*
+  Course: TND004, Lab 2
+  Description: vectorized kernels to normalize text before it is counted in a hash table
+              On x86-64, the AVX2 versions are compiled whatever the compiler flags and
+              selected at run time, if the processor supports AVX2
+              Otherwise the scalar versions are used
+*/
+
+#ifndef TEXT_NORMALIZE_H
+#define TEXT_NORMALIZE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+//The AVX2 kernels are compiled with the target attribute, so no -mavx2 flag is needed
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_NORMALIZE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+//Return true if the AVX2 kernels can be used on this processor
+//The processor is tested once
+inline bool cpu_has_avx2()
+{
+#if defined(TEXT_NORMALIZE_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+
+//Transform all upper-case letters in [p, p+n) to lower-case letters, in place
+//Only 'A'..'Z' are changed, as ::tolower does in the "C" locale
+inline void lowercase_ascii_scalar(char* p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (p[i] >= 'A' && p[i] <= 'Z')
+        {
+            p[i] += 'a' - 'A';
+        }
+    }
+}
+
+#if defined(TEXT_NORMALIZE_AVX2)
+//As lowercase_ascii_scalar, 32 characters at a time
+//Must only be called if cpu_has_avx2()
+AVX2_TARGET inline void lowercase_ascii_avx2(char* p, size_t n)
+{
+    const __m256i before_A = _mm256_set1_epi8('A' - 1);
+    const __m256i after_Z = _mm256_set1_epi8('Z' + 1);
+    const __m256i to_lower = _mm256_set1_epi8('a' - 'A');
+
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i*) (p + i));
+
+        //signed compare: bytes >= 0x80 are negative, thus never upper-case
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, before_A),
+                                         _mm256_cmpgt_epi8(after_Z, c));
+
+        c = _mm256_add_epi8(c, _mm256_and_si256(upper, to_lower));
+        _mm256_storeu_si256((__m256i*) (p + i), c);
+    }
+
+    lowercase_ascii_scalar(p + i, n - i);
+}
+#endif
+
+inline void lowercase_ascii(char* p, size_t n)
+{
+#if defined(TEXT_NORMALIZE_AVX2)
+    if (cpu_has_avx2())
+    {
+        lowercase_ascii_avx2(p, n);
+        return;
+    }
+#endif
+
+    lowercase_ascii_scalar(p, n);
+}
+
+
+//Class to represent a set of characters, e.g. white spaces or punctuation signs
+//Membership is tested with a lookup table of 256 entries
+//With AVX2, 32 characters are tested at a time: for a character c = (hi, lo) in nibbles,
+//rows[lo] has bit hi set if c is in the set (only for hi < 8, i.e. ASCII sets)
+class Byte_Set
+{
+public:
+
+    //Create the set of the characters in chars
+    explicit Byte_Set(const string& chars)
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            member[c] = false;
+        }
+
+        for (int l = 0; l < 16; ++l)
+        {
+            rows[l] = 0;
+        }
+
+        bool ascii_only = true;
+
+        for (unsigned char c : chars)
+        {
+            member[c] = true;
+
+            if (c < 0x80)
+                rows[c & 0x0f] |= 1 << (c >> 4);
+            else
+                ascii_only = false;
+        }
+
+        use_avx2 = ascii_only && cpu_has_avx2();
+    }
+
+
+    //Return true if c is in the set
+    bool contains(char c) const
+    {
+        return member[(unsigned char) c];
+    }
+
+
+    //Return the index of the first character of [p, p+n) in the set
+    //If there is no such character then n is returned
+    size_t find_first(const char* p, size_t n) const
+    {
+#if defined(TEXT_NORMALIZE_AVX2)
+        if (use_avx2)
+        {
+            return find_first_avx2(p, n);
+        }
+#endif
+
+        return find_first_scalar(p, n);
+    }
+
+
+    //Remove the characters in the set from [p, p+n), in place
+    //Return the number of remaining characters
+    size_t remove_from(char* p, size_t n) const
+    {
+#if defined(TEXT_NORMALIZE_AVX2)
+        if (use_avx2)
+        {
+            return remove_from_avx2(p, n);
+        }
+#endif
+
+        return remove_from_scalar(p, n);
+    }
+
+
+    //The kernels used by find_first and remove_from, public to be compared by tests
+    //The AVX2 kernels must only be called if cpu_has_avx2(), and for sets of ASCII characters
+    size_t find_first_scalar(const char* p, size_t n, size_t i = 0) const
+    {
+        for (; i < n && !contains(p[i]); ++i);
+
+        return i;
+    }
+
+    size_t remove_from_scalar(char* p, size_t n, size_t i = 0, size_t out = 0) const
+    {
+        for (; i < n; ++i)
+        {
+            p[out] = p[i];
+            out += !contains(p[i]);
+        }
+
+        return out;
+    }
+
+#if defined(TEXT_NORMALIZE_AVX2)
+    AVX2_TARGET size_t find_first_avx2(const char* p, size_t n) const
+    {
+        size_t i = 0;
+
+        for (; i + 32 <= n; i += 32)
+        {
+            uint32_t mask = match(_mm256_loadu_si256((const __m256i*) (p + i)));
+
+            if (mask)
+            {
+                return i + __builtin_ctz(mask);
+            }
+        }
+
+        return find_first_scalar(p, n, i);
+    }
+
+    AVX2_TARGET size_t remove_from_avx2(char* p, size_t n) const
+    {
+        size_t i = 0, out = 0;
+
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i c = _mm256_loadu_si256((const __m256i*) (p + i));
+
+            if (!match(c))
+            {
+                //no character to remove, move the whole block
+                if (out != i)
+                    _mm256_storeu_si256((__m256i*) (p + out), c);
+
+                out += 32;
+                continue;
+            }
+
+            for (size_t j = i; j < i + 32; ++j)
+            {
+                p[out] = p[j];
+                out += !contains(p[j]);
+            }
+        }
+
+        return remove_from_scalar(p, n, i, out);
+    }
+#endif
+
+private:
+
+#if defined(TEXT_NORMALIZE_AVX2)
+    //Return a mask with bit j set if the j-th character of c is in the set
+    //Only correct for ASCII sets
+    AVX2_TARGET uint32_t match(__m256i c) const
+    {
+        const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+        const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0);
+
+        __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) rows));
+
+        __m256i lo = _mm256_and_si256(c, low_nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), low_nibble);
+
+        __m256i row = _mm256_shuffle_epi8(table, lo);
+        __m256i bit = _mm256_shuffle_epi8(bits, hi);
+
+        __m256i absent = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256());
+
+        return ~(uint32_t) _mm256_movemask_epi8(absent);
+    }
+#endif
+
+    bool member[256];
+    uint8_t rows[16];
+
+    //true if the set has only ASCII characters and the processor supports AVX2
+    bool use_avx2;
+};
+
+#endif
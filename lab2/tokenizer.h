@@ -0,0 +1,73 @@
+/*
+  Course: TND004, Lab 2
+  Description: class Word_Tokenizer splits a buffer of text in normalized words
+*/
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include "textNormalize.h"
+
+#include <string>
+#include <string_view>
+#include <algorithm>
+
+using namespace std;
+
+
+//Class to split a buffer of characters in words, separated by white spaces
+//Each word is transformed to lower-case letters and its punctuation signs are removed
+//The words are normalized in place and returned as string_views into the buffer
+//Thus, no strings are created
+//The buffer is lower-cased ahead of the words, in blocks, with the kernels of textNormalize.h
+class Word_Tokenizer
+{
+public:
+
+    //Tokenize the characters in [first, last), which are modified in place
+    //punct contains the punctuation signs to remove
+    Word_Tokenizer(char* first, char* last, const string& punct)
+        : pos(first), end(last), lowered(first), spaces(" \t\n\v\f\r"), punctuation(punct) {  }
+
+
+    //Find the next word, transform it to lower-case letters and remove the punctuation signs
+    //Return false if there are no more words
+    //Note: a word made only of punctuation signs gives an empty word, as operator>> does
+    bool next(string_view& word)
+    {
+        while (pos != end && spaces.contains(*pos)) ++pos;
+
+        if (pos == end)
+        {
+            return false;
+        }
+
+        char* first = pos;
+        pos += spaces.find_first(pos, end - pos);
+
+        while (lowered < pos)
+        {
+            size_t n = min<size_t>(LOWER_BLOCK, end - lowered);
+
+            lowercase_ascii(lowered, n);
+            lowered += n;
+        }
+
+        word = string_view(first, punctuation.remove_from(first, pos - first));
+        return true;
+    }
+
+private:
+
+    //Number of characters lower-cased at a time, small enough to stay in the cache
+    static constexpr size_t LOWER_BLOCK = 16 * 1024;
+
+    char* pos;
+    char* end;
+    char* lowered; //[begin, lowered) is already lower-cased
+
+    Byte_Set spaces;
+    Byte_Set punctuation;
+};
+
+#endif